@@ -2,14 +2,32 @@
 # Automatically-generated file. Do not edit or delete the file
 ################################################################################
 
+autopilot.c
+
 buttons.c
 
+escape_sequence.c
+
 game.c
 
+high_scores.c
+
+input.c
+
+input_log.c
+
 ledmatrix.c
 
+levels.c
+
+lives_leds.c
+
+profiler.c
+
 project.c
 
+scheduler.c
+
 score.c
 
 scrolling_char_display.c
@@ -18,6 +36,8 @@ serialio.c
 
 spi.c
 
+telemetry.c
+
 terminalio.c
 
 timer0.c
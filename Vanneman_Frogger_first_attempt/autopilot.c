@@ -0,0 +1,269 @@
+/*
+ * autopilot.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include "autopilot.h"
+#include "game.h"
+#include "levels.h"
+#include "field.h"
+#include "scheduler.h"
+#include "timer0.h"
+
+// The search. reachable[step][row] has bit n set if the frog could be
+// alive in column n of that row after the given number of steps (step 0
+// is now). A step is the frog making one move (or staying put) and then
+// the next lane scroll (several lanes if they are due at the same time).
+// step_scrolls[step] has bit n set if pattern n scrolls at the end of that
+// step.
+static FieldMask reachable[AUTOPILOT_HORIZON + 1][FIELD_ROWS];
+static uint8_t step_scrolls[AUTOPILOT_HORIZON + 1];
+
+// The columns that will scroll on to each lane during the search (bit k
+// for the kth scroll, as given by pattern_lookahead()). Looked up once
+// per search so each step only needs a shift.
+static uint32_t incoming[NUM_PATTERNS];
+
+// Direction each pattern scrolls in
+static int8_t pattern_directions[NUM_PATTERNS];
+
+static uint8_t active;
+// When we next need to search (after the next lane scroll or after our
+// last move). plan_now is set instead when we have just been turned on.
+static uint32_t next_plan_time;
+static uint8_t plan_now;
+
+static int8_t plan_move(uint32_t now);
+static uint8_t search(uint8_t* goal_row);
+static FieldMask scroll_mask(FieldMask mask, int8_t direction, uint8_t new_bit);
+static uint8_t carried(uint8_t step, uint8_t row);
+
+void autopilot_set_active(uint8_t new_active) {
+	if(new_active && !active) {
+		plan_now = 1;
+	}
+	active = new_active;
+}
+
+uint8_t autopilot_active(void) {
+	return active;
+}
+
+uint8_t autopilot_event_due(uint32_t now) {
+	return active && (plan_now || time_after_eq(now, next_plan_time));
+}
+
+uint8_t autopilot_next(InputEvent* event, uint32_t now) {
+	int8_t action;
+
+	if(!autopilot_event_due(now)) {
+		return 0;
+	}
+	plan_now = 0;
+	action = plan_move(now);
+	if(action < 0) {
+		return 0;
+	}
+	event->action = action;
+	event->kind = INPUT_PRESS;
+	event->source = INPUT_FROM_AUTOPILOT;
+	event->time = get_current_time();
+	return 1;
+}
+
+// Search ahead and return the first move to make now (INPUT_MOVE_...),
+// or -1 if the frog should stay where it is. Sets next_plan_time.
+static int8_t plan_move(uint32_t now) {
+	uint8_t frog_row = get_frog_row(0);
+	uint8_t frog_column = get_frog_column(0);
+	uint8_t row, column, step, steps;
+	FieldMask cells;
+
+	// Nothing to do until the frog is back on the field (a frog that has
+	// been hit, or is on the riverbank, is put back by the main loop)
+	next_plan_time = now + 1;
+	if(is_decremented() || frog_row >= RIVERBANK_ROW || frog_column >= FIELD_COLUMNS) {
+		return -1;
+	}
+
+	steps = search(&row);
+	if(steps == 0) {
+		// The frog can't survive whatever it does - leave it
+		return -1;
+	}
+
+	// Pick a cell at the end and work back to where the first move takes
+	// the frog. Any cell at step-1 that the frog could have moved from is
+	// on a path, as every cell at step-1 is reachable.
+	cells = reachable[steps][row];
+	for(column = 0; !((cells >> column) & 1); column++) {
+		;
+	}
+	for(step = steps; ; step--) {
+		// Undo the scroll at the end of the step - a frog on a log was
+		// carried with it
+		if(carried(step, row)) {
+			column -= pattern_directions[get_row_pattern(row)];
+		}
+		if(step == 1) {
+			break;
+		}
+		cells = reachable[step - 1][row];
+		if((cells >> column) & 1) {
+			; // stayed put
+		} else if(column > 0 && ((cells >> (column - 1)) & 1)) {
+			column--;
+		} else if(column < FIELD_COLUMNS - 1 && ((cells >> (column + 1)) & 1)) {
+			column++;
+		} else if(row > 0 && ((reachable[step - 1][row - 1] >> column) & 1)) {
+			row--;
+		} else {
+			row++;
+		}
+	}
+
+	if(row > frog_row) {
+		next_plan_time = now;
+		return INPUT_MOVE_FORWARD;
+	} else if(row < frog_row) {
+		next_plan_time = now;
+		return INPUT_MOVE_BACKWARD;
+	} else if(column < frog_column) {
+		next_plan_time = now;
+		return INPUT_MOVE_LEFT;
+	} else if(column > frog_column) {
+		next_plan_time = now;
+		return INPUT_MOVE_RIGHT;
+	}
+	// Wait for the next scroll (next_plan_time was set by search())
+	return -1;
+}
+
+// Fill in reachable[] and step_scrolls[] from the current state of the
+// field. Returns the number of steps to the end of the best path (0 if
+// there isn't one) and sets *goal_row to the row it ends in - the riverbank
+// if a hole can be reached (in which case the last step has no scroll),
+// otherwise the furthest row up the field at the end of the horizon. Sets
+// next_plan_time to the time of the first scroll.
+static uint8_t search(uint8_t* goal_row) {
+	const LevelSettings* level = current_level();
+	FieldMask death[FIELD_ROWS];
+	FieldMask moved[FIELD_ROWS];
+	uint32_t deadlines[NUM_PATTERNS];
+	uint8_t scrolls[NUM_PATTERNS];
+	uint8_t pattern_rows[NUM_PATTERNS];
+	uint8_t row, pattern, step;
+	int8_t row_pattern;
+
+	for(pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+		pattern_directions[pattern] = (pattern < NUM_TRAFFIC_LANES) ?
+				level->lanes[pattern].direction :
+				level->channels[pattern - NUM_TRAFFIC_LANES].direction;
+		incoming[pattern] = pattern_lookahead(pattern, pattern_directions[pattern],
+				AUTOPILOT_HORIZON);
+		deadlines[pattern] = scheduler_next_deadline(pattern);
+		scrolls[pattern] = 0;
+	}
+	for(row = 0; row < FIELD_ROWS; row++) {
+		death[row] = get_death_mask(row);
+		reachable[0][row] = 0;
+		row_pattern = get_row_pattern(row);
+		if(row_pattern >= 0) {
+			pattern_rows[row_pattern] = row;
+		}
+	}
+	reachable[0][get_frog_row(0)] = (FieldMask)1 << get_frog_column(0);
+
+	for(step = 0; step < AUTOPILOT_HORIZON; step++) {
+		FieldMask* cells = reachable[step];
+		FieldMask* next_cells = reachable[step + 1];
+		uint32_t scroll_time;
+		uint8_t scrolled = 0;
+
+		// The frog moves one cell (or stays put) - but not on to a cell
+		// where it would die now. (The frog never gets to the riverbank
+		// row before the search ends so it never moves within it.)
+		for(row = 0; row < FIELD_ROWS; row++) {
+			FieldMask mask = cells[row] | (cells[row] << 1) | (cells[row] >> 1);
+			if(row > 0) {
+				mask |= cells[row - 1];
+			}
+			if(row < FIELD_ROWS - 1) {
+				mask |= cells[row + 1];
+			}
+			moved[row] = mask & ~death[row] & FIELD_ALL_COLUMNS;
+		}
+		if(moved[RIVERBANK_ROW]) {
+			// Made it to a hole
+			for(row = 0; row < FIELD_ROWS; row++) {
+				next_cells[row] = moved[row];
+			}
+			step_scrolls[step + 1] = 0;
+			*goal_row = RIVERBANK_ROW;
+			return step + 1;
+		}
+
+		// Then the lanes that are due next scroll
+		scroll_time = deadlines[0];
+		for(pattern = 1; pattern < NUM_PATTERNS; pattern++) {
+			if(time_before(deadlines[pattern], scroll_time)) {
+				scroll_time = deadlines[pattern];
+			}
+		}
+		if(step == 0) {
+			next_plan_time = scroll_time;
+		}
+		for(pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+			if(deadlines[pattern] != scroll_time) {
+				continue;
+			}
+			int8_t direction = pattern_directions[pattern];
+			uint8_t new_bit = (incoming[pattern] >> scrolls[pattern]) & 1;
+			row = pattern_rows[pattern];
+
+			scrolled |= (1 << pattern);
+			scrolls[pattern]++;
+			deadlines[pattern] += scheduler_period(pattern);
+			if(pattern < NUM_TRAFFIC_LANES) {
+				death[row] = scroll_mask(death[row], direction, new_bit);
+			} else {
+				// The frog dies where there isn't a log. A frog on a log
+				// moves with it (and falls off at the edge).
+				death[row] = scroll_mask(death[row], direction, !new_bit);
+				moved[row] = scroll_mask(moved[row], direction, 0);
+			}
+		}
+		step_scrolls[step + 1] = scrolled;
+
+		// A frog is hit if a vehicle has just scrolled on to it
+		for(row = 0; row < FIELD_ROWS; row++) {
+			next_cells[row] = moved[row] & ~death[row];
+		}
+	}
+
+	// No hole within reach - aim for the furthest row up the field
+	for(row = RIVERBANK_ROW; row > 0 && !reachable[AUTOPILOT_HORIZON][row]; row--) {
+		;
+	}
+	*goal_row = row;
+	return reachable[AUTOPILOT_HORIZON][row] ? AUTOPILOT_HORIZON : 0;
+}
+
+// Shift a mask one column in the given direction (1 is right - to higher
+// bits) and put new_bit in the column that comes on to the field
+static FieldMask scroll_mask(FieldMask mask, int8_t direction, uint8_t new_bit) {
+	if(direction > 0) {
+		return ((mask << 1) | new_bit) & FIELD_ALL_COLUMNS;
+	} else if(direction < 0) {
+		return (mask >> 1) | ((FieldMask)new_bit << (FIELD_COLUMNS - 1));
+	}
+	return mask;
+}
+
+// Return 1 if a frog in the given row is carried by a log at the end of
+// the given step
+static uint8_t carried(uint8_t step, uint8_t row) {
+	int8_t pattern = get_row_pattern(row);
+	return pattern >= NUM_TRAFFIC_LANES && ((step_scrolls[step] >> pattern) & 1);
+}
@@ -0,0 +1,53 @@
+/*
+ * autopilot.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Plays the game for player 1 - as an attract mode when nobody is
+ * playing, or to load the game for testing. Its moves come out of
+ * get_input_event() (see input.h) like button pushes, so they are logged
+ * and replayed in the same way.
+ * Whenever the field changes the autopilot looks ahead over the next
+ * AUTOPILOT_HORIZON lane scrolls. The times of the scrolls come from the
+ * scheduler and the columns that will come on to the display from the
+ * lane patterns (worked out once for each lane and kept in a small table),
+ * so the death mask of every row is known at every step. The search is a
+ * breadth first search over (row, column, step) done a whole row at a
+ * time: the cells the frog could be alive in after each step are kept as
+ * one mask per row. The frog takes the shortest path to a hole in the
+ * riverbank - or, if none can be reached within the horizon, the path
+ * that gets it furthest up the field.
+ * While the autopilot is active the lanes must be in the scheduler slots
+ * with their pattern numbers (see levels.h and schedule_lanes() in
+ * project.c).
+ */
+
+#ifndef AUTOPILOT_H_
+#define AUTOPILOT_H_
+
+#include <stdint.h>
+#include "input.h"
+
+// Number of lane scrolls looked ahead. Each takes FIELD_ROWS masks of RAM.
+#ifndef AUTOPILOT_HORIZON
+#define AUTOPILOT_HORIZON 12
+#endif
+#if AUTOPILOT_HORIZON < 1 || AUTOPILOT_HORIZON > 32
+#error "AUTOPILOT_HORIZON must be from 1 to 32"
+#endif
+
+// Turn the autopilot on or off. It starts off.
+void autopilot_set_active(uint8_t active);
+uint8_t autopilot_active(void);
+
+// Return 1 if the autopilot is due to work out its next move (so it may
+// have an input event). now is the game time (see get_game_time() in
+// timer0.h). Safe to call with interrupts off.
+uint8_t autopilot_event_due(uint32_t now);
+
+// Get the autopilot's next move, if it is due. Returns 1 and fills in
+// *event (an INPUT_PRESS from INPUT_FROM_AUTOPILOT) if there is one, 0
+// otherwise.
+uint8_t autopilot_next(InputEvent* event, uint32_t now);
+
+#endif /* AUTOPILOT_H_ */
@@ -8,21 +8,32 @@
 #include <avr/interrupt.h>
 #include "buttons.h"
 #include "game.h"
+#include "timer0.h"
 
 // Global variable to keep track of the last button state so that we 
 // can detect changes when an interrupt fires. The lower 4 bits (0 to 3)
 // will correspond to the last state of port B pins 0 to 3.
+// This is the debounced state - a change on a pin is ignored if it comes
+// within BUTTON_DEBOUNCE_TIME ms of the last change we accepted on that pin.
+// last_change_time holds the clock tick of that change. The whole tick is
+// kept so a button that has been left alone for a long time can't look
+// like it only just changed once a shorter count wraps around.
+#define BUTTON_DEBOUNCE_TIME 20
 static volatile uint8_t last_button_state;
+static volatile uint32_t last_change_time[4];
 
-// Our button queue. button_queue[0] is always the head of the queue. If we
-// take something off the queue we just move everything else along. We don't
-// use a circular buffer since it is usually expected that the queue is very
-// short. In most uses it will never have more than 1 element at a time.
-// This button queue can be changed by the interrupt handler below so we should
-// turn off interrupts if we're changing the queue outside the handler.
-#define BUTTON_QUEUE_SIZE 4
-static volatile uint8_t button_queue[BUTTON_QUEUE_SIZE];
-static volatile int8_t queue_length;
+// Our button queue - a circular buffer of button events. Only the interrupt
+// handler below adds events (and changes queue_head) and only the main
+// program removes them (and changes queue_tail). Each index is a single
+// byte so it is read and written in one go, which means neither side
+// needs to turn interrupts off. The queue is empty when the indices are
+// equal, so it can hold BUTTON_QUEUE_SIZE-1 events.
+#define BUTTON_QUEUE_SIZE 16	// must be power of 2
+static volatile ButtonEvent button_queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+
+static void check_for_button_changes(void);
 
 // Setup interrupt if any of pins B0 to B3 change. We do this
 // using a pin change interrupt. These pins correspond to pin
@@ -41,60 +52,89 @@ void init_button_interrupts(void) {
 	PCMSK1 |= (1<<PCINT8)|(1<<PCINT9)|(1<<PCINT10)|(1<<PCINT11);	
 	
 	// Empty the button push queue
-	queue_length = 0;
+	queue_head = queue_tail = 0;
 }
 
 int8_t button_pushed(void) {
-	int8_t return_value = NO_BUTTON_PUSHED;	// Assume no button pushed
-	if(queue_length > 0) {
-		// Remove the first element off the queue and move all the other
-		// entries closer to the front of the queue. We turn off interrupts (if on)
-		// before we make any changes to the queue. If interrupts were on
-		// we turn them back on when done.
-		return_value = button_queue[0];
-		
-		// Save whether interrupts were enabled and turn them off
-		int8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
-		cli();
-		
-		for(uint8_t i = 1; i < queue_length; i++) {
-			button_queue[i-1] = button_queue[i];
-		}
-		queue_length--;
-		
-		if(interrupts_were_enabled) {
-			// Turn them back on again
-			sei();
+	ButtonEvent event;
+	while(get_button_event(&event)) {
+		if(event.pressed) {
+			return event.button;
 		}
 	}
-	return return_value;
+	return NO_BUTTON_PUSHED;
+}
+
+uint8_t get_button_event(ButtonEvent* event) {
+	uint8_t tail = queue_tail;
+	if(tail == queue_head) {
+		// Queue is empty
+		return 0;
+	}
+	event->button = button_queue[tail].button;
+	event->pressed = button_queue[tail].pressed;
+	event->time = button_queue[tail].time;
+	
+	// Only move the tail on once we've copied the event so the interrupt
+	// handler can't overwrite it while we're reading it
+	queue_tail = (tail + 1) & (BUTTON_QUEUE_SIZE - 1);
+	return 1;
+}
+
+void update_button_state(void) {
+	int8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	check_for_button_changes();
+	if(interrupts_were_enabled) {
+		sei();
+	}
 }
 
 // Interrupt handler for a change on buttons
 ISR(PCINT1_vect) {
+	check_for_button_changes();
+}
+
+// Compare the current state of the buttons with the last (debounced)
+// state and add an event to the queue for each button that has changed.
+// Must be called with interrupts off.
+static void check_for_button_changes(void) {
 	// Get the current state of the buttons. We'll compare this with
 	// the last state to see what has changed.
 	uint8_t button_state = PINB & 0x0F;
 	
+	uint32_t now = get_current_time();
+	
 	// Iterate over all the buttons and see which ones have changed.
-	// Any button pushes are added to the queue of button pushes (if
-	// there is space). We ignore button releases so we're just looking
-	// for a transition from 0 in the last_button_state bit to a 1 in the 
-	// button_state.
+	// Any button pushes or releases are added to the queue (if there
+	// is space). Changes that are too soon after the last change on
+	// that button are contact bounce and are ignored. (If there is no
+	// space, or the change was ignored, the last state is left as it
+	// was so the change will be picked up next time we're called.)
 	for(uint8_t pin=0; pin<=3; pin++) {
-		if(queue_length < BUTTON_QUEUE_SIZE && 
-				(button_state & (1<<pin)) && 
-				!(last_button_state & (1<<pin))) {
-			// Add the button push to the queue (and update the
-			// length of the queue
-			button_queue[queue_length++] = pin;
+		uint8_t head = queue_head;
+		uint8_t next_head = (head + 1) & (BUTTON_QUEUE_SIZE - 1);
+		if(((button_state ^ last_button_state) & (1<<pin)) &&
+				time_after_eq(now, last_change_time[pin] + BUTTON_DEBOUNCE_TIME) &&
+				next_head != queue_tail) {
+			// Add the event to the queue. The head is moved on last
+			// so the event is complete before the main program sees it.
+			button_queue[head].button = pin;
+			button_queue[head].pressed = (button_state >> pin) & 1;
+			button_queue[head].time = now;
+			queue_head = next_head;
+			
+			// Remember this button state
+			last_button_state ^= (1<<pin);
+			last_change_time[pin] = now;
 		}
 	}
-	
-	// Remember this button state
-	last_button_state = button_state;
 }
 
 uint8_t show_button_state(void){
 	return last_button_state;
+}
+
+uint8_t button_pushes_waiting(void) {
+	return (queue_head - queue_tail) & (BUTTON_QUEUE_SIZE - 1);
 }
\ No newline at end of file
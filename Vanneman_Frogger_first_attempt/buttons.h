@@ -21,14 +21,42 @@
  */
 void init_button_interrupts(void);
 
+/* A button push or release. time is the clock tick (see get_current_time())
+ * when it happened.
+ */
+typedef struct {
+	uint8_t button;		// 0 to 3
+	uint8_t pressed;	// 1 if pushed, 0 if released
+	uint32_t time;
+} ButtonEvent;
+
 /* Return the last button pushed (0 to 3) or -1 (NO_BUTTON_PUSHED) if 
- * there are no button pushes to return. (A small queue of button pushes
+ * there are no button pushes to return. (A small queue of button events
  * is kept. This function should be called frequently enough to
- * ensure the queue does not overflow. Excess button pushes are
- * discarded.)
+ * ensure the queue does not overflow. Excess button events are
+ * discarded.) Any button releases ahead of the push in the queue are
+ * discarded.
  */
 
 int8_t button_pushed(void);
 uint8_t show_button_state(void);
 
+/* Take the next button event (push or release) off the queue. Returns 1
+ * and fills in *event if there was one, 0 if the queue is empty.
+ */
+uint8_t get_button_event(ButtonEvent* event);
+
+/* Button pushes and releases are debounced - a change on a button within
+ * 20ms of the last one is ignored. If a button stops bouncing in a
+ * different state to the one we last accepted there may be no further
+ * pin change interrupt, so this function should be called regularly
+ * (e.g. from the main loop) to pick up such changes.
+ */
+void update_button_state(void);
+
+/* Return the number of button events waiting in the queue. This does not
+ * remove them from the queue.
+ */
+uint8_t button_pushes_waiting(void);
+
 #endif /* BUTTONS_H_ */
\ No newline at end of file
@@ -0,0 +1,94 @@
+/*
+ * escape_sequence.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include "escape_sequence.h"
+
+// ASCII code for Escape character
+#define ESCAPE_CHAR 27
+
+// Parser states
+#define STATE_GROUND	0	// not in an escape sequence
+#define STATE_ESCAPE	1	// had ESC
+#define STATE_CSI		2	// had ESC [ (and possibly some parameters)
+#define STATE_SS3		3	// had ESC O
+
+// The longest sequence we will wait for. Anything longer is garbage (or
+// we missed the end of it) so we give up and start again.
+#define MAX_SEQUENCE_LENGTH 8
+
+static uint8_t state;
+static uint8_t sequence_length;
+
+static int16_t cursor_key(char final);
+
+void escape_sequence_reset(void) {
+	state = STATE_GROUND;
+	sequence_length = 0;
+}
+
+int16_t escape_sequence_feed(char c) {
+	switch(state) {
+		case STATE_ESCAPE:
+			if(c == '[') {
+				state = STATE_CSI;
+				sequence_length++;
+				return KEY_NONE;
+			} else if(c == 'O') {
+				state = STATE_SS3;
+				sequence_length++;
+				return KEY_NONE;
+			} else if(c == ESCAPE_CHAR) {
+				// Another escape - start again from this one
+				return KEY_NONE;
+			}
+			// Not a sequence we know - treat the character as ordinary
+			state = STATE_GROUND;
+			break;
+		case STATE_CSI:
+			if(c >= 0x40 && c <= 0x7E) {
+				// Final character of the sequence
+				state = STATE_GROUND;
+				return cursor_key(c);
+			} else if(c >= 0x20 && c <= 0x3F && 
+					++sequence_length < MAX_SEQUENCE_LENGTH) {
+				// Parameter or intermediate character (e.g. digits and ;)
+				// - we don't use these so just skip them
+				return KEY_NONE;
+			}
+			// Invalid or over long sequence - throw it away
+			state = STATE_GROUND;
+			return KEY_UNKNOWN;
+		case STATE_SS3:
+			state = STATE_GROUND;
+			return cursor_key(c);
+		default:
+			break;
+	}
+	
+	// STATE_GROUND
+	if(c == ESCAPE_CHAR) {
+		state = STATE_ESCAPE;
+		sequence_length = 1;
+		return KEY_NONE;
+	}
+	return (uint8_t)c;
+}
+
+// Return the key for the final character of a cursor key sequence
+static int16_t cursor_key(char final) {
+	switch(final) {
+		case 'A':
+			return KEY_UP;
+		case 'B':
+			return KEY_DOWN;
+		case 'C':
+			return KEY_RIGHT;
+		case 'D':
+			return KEY_LEFT;
+		default:
+			return KEY_UNKNOWN;
+	}
+}
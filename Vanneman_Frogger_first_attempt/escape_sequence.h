@@ -0,0 +1,34 @@
+/*
+ * escape_sequence.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Turns a stream of characters from a terminal into key presses. Cursor
+ * keys arrive as ANSI escape sequences - ESC [ A for up, or ESC O A if the
+ * terminal is in application cursor key mode - and may include numeric
+ * parameters (e.g. ESC [ 1 ; 5 A for control-up). The parser keeps its
+ * state between calls so a sequence can be split across reads.
+ */
+
+#ifndef ESCAPE_SEQUENCE_H_
+#define ESCAPE_SEQUENCE_H_
+
+#include <stdint.h>
+
+// Values returned by escape_sequence_feed(). Ordinary characters are
+// returned as their character code (0 to 255).
+#define KEY_NONE	-1		// character was part of an unfinished sequence
+#define KEY_UP		0x100
+#define KEY_DOWN	0x101
+#define KEY_RIGHT	0x102
+#define KEY_LEFT	0x103
+#define KEY_UNKNOWN	0x1FF	// a complete sequence we don't recognise
+
+// Forget any partly received escape sequence.
+void escape_sequence_reset(void);
+
+// Give the parser the next character received. Returns the key that it
+// completes, or KEY_NONE if more characters are needed (or it was ignored).
+int16_t escape_sequence_feed(char c);
+
+#endif /* ESCAPE_SEQUENCE_H_ */
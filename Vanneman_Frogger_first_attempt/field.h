@@ -0,0 +1,49 @@
+/*
+ * field.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Size of the game field. The field is as wide as the LED matrix display
+ * (16 columns for one panel, 32 for two panels across) and has FIELD_ROWS
+ * rows from the bottom of the display - 8, or 16 if the display is two
+ * panels high, unless defined otherwise. What each row is (roadside, road,
+ * river or riverbank) is set by the row table for that height in game.c,
+ * so only heights with a table (8 and 16) can be used.
+ * A FieldMask has one bit for each column of the field - bit n is
+ * column n (counting from the left) - and is the smallest type that fits.
+ */
+
+#ifndef FIELD_H_
+#define FIELD_H_
+
+#include <stdint.h>
+#include "ledmatrix.h"
+
+#define FIELD_COLUMNS MATRIX_NUM_COLUMNS
+#ifndef FIELD_ROWS
+#if MATRIX_NUM_ROWS >= 16
+#define FIELD_ROWS 16
+#else
+#define FIELD_ROWS 8
+#endif
+#endif
+
+#if FIELD_COLUMNS <= 16
+typedef uint16_t FieldMask;
+#elif FIELD_COLUMNS <= 32
+typedef uint32_t FieldMask;
+#else
+#error "The game field can't be more than 32 columns wide"
+#endif
+
+#if FIELD_ROWS > MATRIX_NUM_ROWS
+#error "The game field doesn't fit on the display"
+#endif
+#if FIELD_ROWS != 8 && FIELD_ROWS != 16
+#error "There is only a row table for fields 8 or 16 rows high"
+#endif
+
+// A mask with a bit set for every column of the field
+#define FIELD_ALL_COLUMNS ((FieldMask)(~(FieldMask)0) >> (8 * sizeof(FieldMask) - FIELD_COLUMNS))
+
+#endif /* FIELD_H_ */
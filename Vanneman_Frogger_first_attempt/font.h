@@ -0,0 +1,80 @@
+/*
+ * font.h
+ *
+ * Author: Peter Sutton. Modified by Becca Vanneman
+ *
+ * The font used by the scrolling display (see scrolling_char_display.h),
+ * as macros so that text can be rendered into column data when the
+ * program is compiled - e.g.
+ *     static const uint8_t banner[] PROGMEM = {
+ *         FONT_GAP, FONT_H, FONT_GAP, FONT_I
+ *     };
+ * gives the same columns as scrolling "HI".
+ *
+ * Each macro gives the columns of data to be displayed
+ * for a character (A-Z and 0-9). The most significant
+ * 7 bits (bit 7 to bit 1) represent the data for rows 7 to 1 
+ * (top to bottom). The least significant bit is 1 only for
+ * the last column of letter data. (This is how the software
+ * will know when it has reached the last column for this 
+ * character. We do not display data for this bit, i.e. 
+ * row y=0 on the display will always be blank.
+ * As an example, the data for the 4 columns of letter A is as 
+ * follows:
+ * bit 7  ** 
+ * bit 6 *  *
+ * bit 5 *  *
+ * bit 4 ****
+ * bit 3 *  *
+ * bit 2 *  *
+ * bit 1 *  *
+ * bit 0    *
+ */
+
+#ifndef FONT_H_
+#define FONT_H_
+
+/* The blank column shown before each character (and for a space) */
+#define FONT_GAP 0
+
+/* Letters A-Z */
+#define FONT_A 126, 144, 144, 127
+#define FONT_B 254, 146, 146, 109
+#define FONT_C 124, 130, 130, 69
+#define FONT_D 254, 130, 130, 125
+#define FONT_E 254, 146, 146, 131
+#define FONT_F 254, 144, 144, 129
+#define FONT_G 124, 130, 146, 93
+#define FONT_H 254, 16, 16, 255
+#define FONT_I 130, 254, 131
+#define FONT_J 4, 2, 2, 253
+#define FONT_K 254, 16, 40, 199
+#define FONT_L 254, 2, 2, 3
+#define FONT_M 254, 64, 48, 64, 255
+#define FONT_N 254, 32, 16, 255
+#define FONT_O 124, 130, 130, 125
+#define FONT_P 254, 144, 144, 97
+#define FONT_Q 124, 130, 138, 124, 3
+#define FONT_R 254, 144, 152, 103
+#define FONT_S 100, 146, 146, 77
+#define FONT_T 128, 128, 254, 128, 129
+#define FONT_U 252, 2, 2, 253
+#define FONT_V 248, 4, 2, 4, 249
+#define FONT_W 252, 2, 28, 2, 253
+#define FONT_X 198, 40, 16, 40, 199
+#define FONT_Y 224, 16, 14, 16, 225
+#define FONT_Z 134, 138, 146, 162, 195
+
+/* Numbers 0 to 9 */
+#define FONT_0 124, 146, 162, 125
+#define FONT_1 66, 254, 3
+#define FONT_2 70, 138, 146, 99
+#define FONT_3 68, 146, 146, 109
+#define FONT_4 24, 40, 72, 255
+#define FONT_5 228, 162, 162, 157
+#define FONT_6 124, 146, 146, 77
+#define FONT_7 128, 158, 160, 193
+#define FONT_8 108, 146, 146, 109
+#define FONT_9 100, 146, 146, 125
+
+#endif /* FONT_H_ */
@@ -4,366 +4,305 @@
  * Author: Becca Vanneman
  */ 
 
-#include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "game.h"
 #include "ledmatrix.h"
 #include "pixel_colour.h"
 #include "score.h"
-#include "scrolling_char_display.h"
 #include "buttons.h"
-#include "timer0.h"
+#include "profiler.h"
+#include "levels.h"
+#include "field.h"
+#include "lives_leds.h"
 #include <stdint.h>
 
-#define F_CPU 8000000L
-#include <util/delay.h>
-
 ///////////////////////////////// Global variables //////////////////////
-// frog_row and frog_column store the current position of the frog. Row 
-// numbers are from 0 to 7; column numbers are from 0 to 15. 
-static int8_t frog_row;
-static int8_t frog_column;
-
-// Boolean flag to indicate whether the frog is alive or dead
+// The position of each frog. Row numbers are from 0 to FIELD_ROWS-1;
+// column numbers are from 0 to FIELD_COLUMNS-1 (a frog that jumps off
+// the field is outside these). hit is 1 once the frog has been run over,
+// drowned etc. - it then stays where it is, drawn as a dead frog, until
+// the next life.
+typedef struct {
+	int8_t row;
+	int8_t column;
+	uint8_t hit;
+} Frog;
+static Frog frogs[NUM_FROGS];
+
+// Where the frogs are. Bit n of frog_mask[row] is 1 if there is a frog in
+// column n of that row. Kept up to date as the frogs move, so when a lane
+// scrolls all the frogs in its row are checked against its death mask at
+// once (and rows without frogs cost nothing).
+static FieldMask frog_mask[FIELD_ROWS];
+
+// Boolean flag to indicate whether the frogs are out of lives. The lives
+// are shared by all the frogs. decrement is 1 if a frog has been hit
+// (and a life lost) since the start of this life.
 static uint8_t frog_dead;
 static uint8_t frog_lives;
 static uint8_t decrement;
 
 
-// Vehicle data - 64 bits in each lane which we loop continuously. A 1
-// indicates the presence of a vehicle, 0 is empty.
-// Index 0 to 2 corresponds to lanes 1 to 3 respectively. Lanes 1 and 3
-// will move to the right; lane 2 will move to the left.
-#define LANE_DATA_WIDTH 64	// must be power of 2
-static uint64_t lane_data[3] = {
-		0b1100001100011000110000011001100011000011000110001100000110011000,
-		0b0011100000111000011100000111000011100001110001110000111000011100,
-		0b0000111100001111000011110000111100001111000001111100001111000111
-};
-		
-// Log data - 32 bits for each log channel which we loop continuously.
-// A 1 indicates the presence of a log, 0 is empty.
-// Index 0 to 1 corresponds to rows 5 and 6 respectively. Row 5 will move
-// to the left; row 6 will move to the right
-#define LOG_DATA_WIDTH 32 // must be power of 2
-static uint32_t log_data[2] = {
-		0b11110001100111000111100011111000,
-		0b11100110111101100001110110011100
-};
+// The vehicle and log patterns (and everything else that changes from
+// level to level) come from the level pack - see levels.h. The rows the
+// traffic lanes and river channels are in come from row_roles below.
 
-// Lane positions. The bit position (0 to 63) of the lane_data above that is
-// currently in column 0 of the display (left hand side). (Bit position
-// 0 is the least significant bit.) For a lane position of N, the display
-// will show bits N to N+15 from left to right (wrapping around if N+15 
-// exceeds 63). 
-static int8_t lane_position[3];
+// Lane positions. The column of the lane pattern that is currently in
+// column 0 of the display (left hand side). For a lane position of N, the
+// display will show pattern columns N to N+FIELD_COLUMNS-1 from left to
+// right (wrapping around if that goes past the end of the pattern).
+static int16_t lane_position[NUM_TRAFFIC_LANES];
 
 // Log positions. Same principle as lane positions.
-static int8_t log_position[2];
+static int16_t log_position[NUM_RIVER_CHANNELS];
 
 // Colours
+// (The colours of everything else come from the level's palette - see
+// levels.h)
 #define COLOUR_FROG			COLOUR_GREEN
 #define COLOUR_DEAD_FROG	COLOUR_LIGHT_YELLOW
-#define COLOUR_EDGES		COLOUR_LIGHT_GREEN
-#define COLOUR_WATER		COLOUR_BLACK
-#define COLOUR_ROAD			COLOUR_BLACK
-#define COLOUR_LOGS			COLOUR_ORANGE
-PixelColour vehicle_colours[3] = { COLOUR_RED, COLOUR_YELLOW, COLOUR_RED }; // by lane
 
-// Rows
+// Colour of each player's frog (frogs that have made it to a hole are
+// COLOUR_FROG)
+static const PixelColour frog_colours[MAX_FROGS] PROGMEM = {
+	COLOUR_FROG, COLOUR_LIGHT_ORANGE
+};
+
+// What each row of the field is, from the bottom up. The traffic lanes
+// are the road rows, numbered from the bottom up, and the river channels
+// likewise - there must be NUM_TRAFFIC_LANES road rows and
+// NUM_RIVER_CHANNELS river rows. The frog starts in the bottom row and
+// finishes in the top row (the riverbank). There is a table for each
+// field height (see field.h).
+#define ROW_ROADSIDE 0 // the frog can rest here
+#define ROW_ROAD 1
+#define ROW_RIVER 2
+#define ROW_RIVERBANK 3
+#if FIELD_ROWS == 8
+static const uint8_t row_roles[FIELD_ROWS] PROGMEM = {
+	ROW_ROADSIDE, ROW_ROAD, ROW_ROAD, ROW_ROAD, 
+	ROW_ROADSIDE, ROW_RIVER, ROW_RIVER, ROW_RIVERBANK
+};
+#else
+// A field two panels high has the same lanes and channels, with a verge
+// two rows wide between the traffic lanes and a wide one before the river
+static const uint8_t row_roles[FIELD_ROWS] PROGMEM = {
+	ROW_ROADSIDE, ROW_ROADSIDE, ROW_ROAD, ROW_ROADSIDE,
+	ROW_ROADSIDE, ROW_ROAD, ROW_ROADSIDE, ROW_ROADSIDE,
+	ROW_ROAD, ROW_ROADSIDE, ROW_ROADSIDE, ROW_ROADSIDE,
+	ROW_ROADSIDE, ROW_RIVER, ROW_RIVER, ROW_RIVERBANK
+};
+#endif
 #define START_ROW 0	// row position where the frog starts
-#define FIRST_VEHICLE_ROW 1
-#define SECOND_VEHICLE_ROW 2
-#define THIRD_VEHICLE_ROW 3
-#define HALFWAY_ROW 4 // row position where the frog can rest
-#define FIRST_RIVER_ROW 5
-#define SECOND_RIVER_ROW 6
-#define RIVERBANK_ROW 7 // row position where the frog finishes
-
-// River bank pattern. Note that the least significant bit in this
-// pattern (RHS) corresponds to column 0 on the display (LHS).
-#define RIVERBANK 0b1101110111011101
-static uint16_t riverbank;
+// Column each frog starts in - side by side, around the middle of the row
+// (a single frog starts just left of the middle)
+#define START_COLUMN(frog) ((FIELD_COLUMNS - NUM_FROGS) / 2 + (frog))
+
+// The row each traffic lane and river channel is in, and the lane or
+// channel in each row (only used for road and river rows). Worked out from
+// row_roles by find_rows().
+static uint8_t lane_row[NUM_TRAFFIC_LANES];
+static uint8_t channel_row[NUM_RIVER_CHANNELS];
+static uint8_t row_lane[FIELD_ROWS];
+
+// River bank pattern for the level. Note that the least significant bit in
+// this pattern (RHS) corresponds to column 0 on the display (LHS).
+static FieldMask riverbank;
 // riverbank_status is a bit pattern similar to riverbank but will
 // only have zeroes where there are unoccupied holes. When this is all 1's
 // then the game/level is complete
-static uint16_t riverbank_status;
-
+static FieldMask riverbank_status;
+
+// Death masks. Bit n of death_mask[row] is 1 if the frog would die in
+// column n of that row (a vehicle, water or a filled hole / riverbank edge)
+// given the current lane and log positions. The lane and river masks are
+// shifted by one bit when a lane scrolls, with just the bit for the column
+// coming on to the display read from the lane data, so checking for a
+// collision never needs a 64 bit shift.
+// The traffic lane masks are also the vehicles to show in each lane, and
+// the inverse of the river masks are the logs, so lanes and logs are drawn
+// from the masks too.
+static FieldMask death_mask[FIELD_ROWS];
+
+// Pixel select bytes for each 4 bit value - byte n is 0xFF if bit n of the
+// value is 1, 0 otherwise. Used to turn a mask into pixels 4 at a time.
+static const uint8_t nibble_selects[16][4] PROGMEM = {
+	{0x00,0x00,0x00,0x00}, {0xFF,0x00,0x00,0x00}, {0x00,0xFF,0x00,0x00}, {0xFF,0xFF,0x00,0x00},
+	{0x00,0x00,0xFF,0x00}, {0xFF,0x00,0xFF,0x00}, {0x00,0xFF,0xFF,0x00}, {0xFF,0xFF,0xFF,0x00},
+	{0x00,0x00,0x00,0xFF}, {0xFF,0x00,0x00,0xFF}, {0x00,0xFF,0x00,0xFF}, {0xFF,0xFF,0x00,0xFF},
+	{0x00,0x00,0xFF,0xFF}, {0xFF,0x00,0xFF,0xFF}, {0x00,0xFF,0xFF,0xFF}, {0xFF,0xFF,0xFF,0xFF}
+};
 
 /////////////////////////////// Function Prototypes for Helper Functions ///////
 // These functions are defined after the public functions. Comments are with the
 // definitions.
 static uint8_t will_frog_die_at_position(int8_t row, int8_t column);
+static uint8_t move_frog(uint8_t frog, int8_t rows, int8_t columns);
+static void frog_hit(uint8_t frog);
+static void frogs_hit(uint8_t row, FieldMask hits);
+static void reset_frogs(void);
+static void update_frog_mask(int8_t row);
+static uint8_t row_role(uint8_t row);
+static void find_rows(void);
+static FieldMask level_riverbank(void);
+static void update_all_death_masks(void);
+static void update_death_mask(uint8_t row);
+static void scroll_death_mask(uint8_t row, int8_t direction, uint8_t new_bit);
+static void set_start_positions(void);
 static void redraw_whole_display(void);
 static void redraw_row(uint8_t row);
 static void redraw_roadside(uint8_t row);
 static void redraw_traffic_lane(uint8_t lane);
 static void redraw_river_channel(uint8_t channel);
 static void redraw_riverbank(void);
-static void redraw_frog(void);
+static void redraw_frogs(int8_t row);
+static void render_mask(MatrixRow row_display_data, FieldMask mask, 
+		PixelColour set_colour, PixelColour clear_colour);
 		
 /////////////////////////////// Public Functions ///////////////////////////////
 // These functions are defined in the same order as declared in game.h
 
 // Reset the game
 void initialise_game(void) {
-	// Initial lane and log positions
-	lane_position[0] = lane_position[1] = lane_position[2] = 0;
-	log_position[0] = log_position[1] = 0;
+	find_rows();
 	
-	vehicle_colours[0] = vehicle_colours[2] = COLOUR_RED;
-	vehicle_colours[1] = COLOUR_YELLOW;
+	// Start at level 1
+	load_level(1);
+	set_start_positions();
 	
 	// Initial riverbank pattern
-	riverbank = RIVERBANK;
-	riverbank_status = RIVERBANK;
+	riverbank = level_riverbank();
+	riverbank_status = riverbank;
+	update_all_death_masks();
 	
-	redraw_whole_display();
 	frog_lives = 3;
+	frog_dead = 0;
+	decrement = 0;
 	init_led();
 	
-	// Add a frog to the roadside - this will redraw the frog
-	put_frog_in_start_position();
+	// Put the frogs on the roadside and show everything
+	reset_frogs();
+	redraw_whole_display();
 }
 
 // Reset the life
-void initialise_life(uint32_t level) {
-	// Initial lane and log positions depending on level
-	if (level%2 == 0) {
-		lane_position[0] = lane_position[1] = lane_position[2] = 1;
-		log_position[0] = log_position[1] = 0;
-	} else if (level%3 == 0) {
-		lane_position[0] = lane_position[1] = lane_position[2] = 0;
-		log_position[0] = log_position[1] = 1;
-	} else {
-		lane_position[0] = lane_position[1] = lane_position[2] = 0;
-		log_position[0] = log_position[1] = 0;
-	}
-	
-	redraw_riverbank();
-		
-	// Start with the starting and halfway rows
-	redraw_roadside(START_ROW);
-	redraw_roadside(HALFWAY_ROW);
-
-	// Redraw traffic lanes
-	for(uint8_t lane=0; lane<=2; lane++) {
-		redraw_traffic_lane(lane);
-	}
+void initialise_life(void) {
+	// Initial lane and log positions for the level
+	set_start_positions();
+	update_all_death_masks();
 	
-	// Redraw river
-	for(uint8_t channel=0; channel<=1; channel++) {
-		redraw_river_channel(channel);
-	}
-
 	decrement = 0;
 	
-	// Add a frog to the roadside - this will redraw the frog
-	put_frog_in_start_position();
+	// Put the frogs back on the roadside and redraw the whole field
+	// (without clearing it first)
+	reset_frogs();
+	for(uint8_t row = 0; row < FIELD_ROWS; row++) {
+		redraw_row(row);
+	}
 }
 
-// Reset the game
+// Move on to a new level. The display isn't changed until show_level()
+// (so the level banner can be shown first).
 void initialise_level(uint32_t level) {
-	
-	uint32_t start_scrolling = get_current_time();
-	while(1) {
-		set_scrolling_display_text(" ", COLOUR_GREEN);
-		// Scroll the message until it has scrolled off the
-		// display or a button is pushed
-		while(scroll_display()) {
-			_delay_ms(150);
-			if (get_current_time() - 1000 >= start_scrolling){
-				break;
-			}
-		}
-		break;
-	}
-	
-	
-	// Initial lane and log positions
-		if (level%2 == 0) {
-			lane_position[0] = lane_position[1] = lane_position[2] = 1;
-			log_position[0] = log_position[1] = 0;
-		} else if (level%3 == 0) {
-			lane_position[0] = lane_position[1] = lane_position[2] = 0;
-			log_position[0] = log_position[1] = 1;
-		} else {
-			lane_position[0] = lane_position[1] = lane_position[2] = 0;
-			log_position[0] = log_position[1] = 0;
-		}
-	
-	// Give different Levels different patterns
-	if (level % 2 == 0){
-		vehicle_colours[0] = vehicle_colours[2] = COLOUR_YELLOW;
-		vehicle_colours[1] = COLOUR_RED;
-	} else if (level % 3 == 0) { 
-		vehicle_colours[1] = vehicle_colours[2] = COLOUR_RED;
-		vehicle_colours[0] = COLOUR_YELLOW;
-	} else {
-		vehicle_colours[0] = vehicle_colours[2] = COLOUR_RED;
-		vehicle_colours[1] = COLOUR_YELLOW;
-	}
+	// Get the lane patterns, colours etc. for the new level
+	load_level(level);
+	set_start_positions();
 	
 	// Reward Leveling up by giving an extra life up to 4
 	increment_lives();
 	
 	// Reset riverbank pattern
-	riverbank = riverbank_by_level(level);
+	riverbank = level_riverbank();
 	riverbank_status = riverbank;
-	
-	redraw_whole_display();
-
-	// Add a frog to the roadside - this will redraw the frog
-	put_frog_in_start_position();
+	update_all_death_masks();
 }
 
-
-
-uint16_t riverbank_by_level(uint32_t level) {
-	if(level % 2 == 0){
-		// Five holes in Riverbank
-		return 0b1101010111011101;
-	} else if (level % 3 == 0){
-		// Six holes in Riverbank
-		return 0b1101010101011101;
-	} else {
-		// Standard 4 holes in Riverbank 
-		return 0b1101110111011101;
-	}
+// Draw the new level, with the frogs on the roadside
+void show_level(void) {
+	reset_frogs();
+	redraw_whole_display();
 }
 
 
-
-// Add a frog to the game
-void put_frog_in_start_position(void) {
-	// Initial starting position of frog (7,0)
-	frog_row = 0;
-	frog_column = 7;
+// Put a frog back at the start (after it has made it to the other side)
+void put_frog_in_start_position(uint8_t frog) {
+	int8_t old_row = frogs[frog].row;
 	
-	// Frog is initially alive
-	frog_dead = 0;
+	frogs[frog].row = START_ROW;
+	frogs[frog].column = START_COLUMN(frog);
+	frogs[frog].hit = 0;
+	update_frog_mask(old_row);
+	update_frog_mask(START_ROW);
 	
-	// Show the frog
-	redraw_frog();
+	// Remove the frog from where it was and show it at the start
+	redraw_row(old_row);
+	redraw_frogs(START_ROW);
 }
 
-// This function assumes that the frog is not in row 7 (the top row). A frog in row 7 is out
-// of the game.
-void move_frog_forward(void) {
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-	
-	// Check whether this move will cause the frog to die or not
-	decrement = will_frog_die_at_position(frog_row+1, frog_column);
-	
-	if (decrement){
-		decrement_lives();
+// This function assumes that the frog is not in RIVERBANK_ROW (the top row). A frog in that
+// row is out of the game.
+void move_frog_forward(uint8_t frog) {
+	if(move_frog(frog, 1, 0)) {
+		// Points for each row forward (whether the frog survived or not),
+		// and more for getting to the riverbank
+		if (frogs[frog].row == RIVERBANK_ROW){
+			add_to_score(10);
+		} else {
+			add_to_score(1);
+		}
 	}
+}
 
-	// Move the frog position forward and show the frog. 
-	// We do this whether the frog is alive or not. 
-	frog_row++;
-	
-	if (frog_row == 7){
-		add_to_score(10);
-	} else {
-		add_to_score(1);
-	}
-	
-	redraw_frog();
-	
-	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
-	if(!frog_dead && !decrement && frog_row == RIVERBANK_ROW) {
-		riverbank_status |= (1<<frog_column);
-	}
+void move_frog_backward(uint8_t frog) {
+	move_frog(frog, -1, 0);
 }
 
-void move_frog_backward(void) {
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-	
-	// Check whether this move will cause the frog to die or not
-	decrement = will_frog_die_at_position(frog_row-1, frog_column);
-	
-	if (decrement){
-		decrement_lives();
-	}
+void move_frog_to_left(uint8_t frog) {
+	move_frog(frog, 0, -1);
+}
 
-	
-	// Move the frog position forward and show the frog.
-	// We do this whether the frog is alive or not.
-	frog_row--;
-	redraw_frog();
-	
-	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
-	if(!frog_dead  && !decrement && frog_row == RIVERBANK_ROW) {
-		riverbank_status |= (1<<frog_column);
-	}
+void move_frog_to_right(uint8_t frog) {
+	move_frog(frog, 0, 1);
 }
 
-void move_frog_to_left(void) {
-	// Comments to aid implementation:
-	// Redraw the row the frog is currently on (i.e. without the frog), check 
-	// whether the frog will live or not, update the frog position (if the position 
-	// is not the leftmost column) then and redraw the frog.
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-	
-	// Check whether this move will cause the frog to die or not
-	decrement = will_frog_die_at_position(frog_row, frog_column-1);
-	
-	if (decrement){
-		decrement_lives();
-	}
-	
-	// Move the frog position forward and show the frog.
-	// We do this whether the frog is alive or not.
-	frog_column--;
-	redraw_frog();
-	
-	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
-	if(!frog_dead  && !decrement && frog_row == RIVERBANK_ROW) {
-		riverbank_status |= (1<<frog_column);
-	}
+uint8_t get_frog_row(uint8_t frog) {
+	return frogs[frog].row;
 }
 
-void move_frog_to_right(void) {
-	// Unimplemented
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-	
-	// Check whether this move will cause the frog to die or not
-	decrement = will_frog_die_at_position(frog_row, frog_column+1);
-	
-	if (decrement){
-		decrement_lives();
-	}
-	
-	// Move the frog position forward and show the frog.
-	// We do this whether the frog is alive or not.
-	frog_column++;
-	redraw_frog();
-	
-	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
-	if(!frog_dead  && !decrement && frog_row == RIVERBANK_ROW) {
-		riverbank_status |= (1<<frog_column);
-	}
+uint8_t get_frog_column(uint8_t frog) {
+	return frogs[frog].column;
+}
+
+uint16_t get_lane_position(uint8_t lane) {
+	return lane_position[lane];
 }
 
-uint8_t get_frog_row(void) {
-	return frog_row;
+uint16_t get_log_position(uint8_t channel) {
+	return log_position[channel];
 }
 
-uint8_t get_frog_column(void) {
-	return frog_column;
+FieldMask get_death_mask(uint8_t row) {
+	return death_mask[row];
+}
+
+int8_t get_row_pattern(uint8_t row) {
+	switch(row_role(row)) {
+		case ROW_ROAD:
+			return LANE_PATTERN(row_lane[row]);
+		case ROW_RIVER:
+			return LOG_PATTERN(row_lane[row]);
+		default:
+			return -1;
+	}
 }
 
 uint8_t is_riverbank_full(void) {
-	return (riverbank_status == 0xFFFF);
+	return (riverbank_status == FIELD_ALL_COLUMNS);
 }
 
-uint8_t frog_has_reached_riverbank(void) {
-	return (frog_row == RIVERBANK_ROW);
+uint8_t frog_has_reached_riverbank(uint8_t frog) {
+	return (frogs[frog].row == RIVERBANK_ROW);
 }
 
 uint8_t is_frog_dead(void) {
@@ -379,53 +318,33 @@ uint8_t is_decremented(void) {
 }
 
 void decrement_lives(void) {
-	if (frog_lives == 4) {
-		frog_lives--;
-		PORTA = 7;
-	} else if (frog_lives ==3) {
-		frog_lives--;
-		PORTA = 3;
-	} else if (frog_lives == 2) {
-		frog_lives--;
-		PORTA = 1;
-	} else {
+	if(frog_lives > 0) {
 		frog_lives--;
+	}
+	if(frog_lives == 0) {
 		frog_dead = 1;
-		PORTA = 0;
 	}
+	show_lives(frog_lives);
 }
 
 void increment_lives(void) {
-	if (frog_lives == 3) {
-		frog_lives++;
-		PORTA = 15;
-	} else if (frog_lives ==2) {
-		frog_lives++;
-		PORTA = 7;
-	} else if (frog_lives == 1) {
+	// Up to 4 lives (but a dead frog stays dead)
+	if(frog_lives > 0 && frog_lives < MAX_LIVES_SHOWN) {
 		frog_lives++;
-		PORTA = 3;
-	} 
+	}
+	show_lives(frog_lives);
 }
 
 void init_led(void) {
-	DDRA |= (1<<DDRA3) | (1<<DDRA2) | (1<<DDRA1) | (1<<DDRA0);
-	PORTA = 7;
-}
-
-void increment_led(void) {
-	//int lives = num_frog_lives();
-	// increment or decrement from here
-	// make sure that num of lives won't go above 4
-	int lives = num_frog_lives();
-	if (lives > 4){
-		//
-	}
+	init_lives_leds();
+	show_lives(frog_lives);
 }
 
 // Scroll the given lane of traffic. (lane value must be 0 to 2)
 void scroll_vehicle_lane(uint8_t lane, int8_t direction) {
-	uint8_t frog_is_in_this_row = (frog_row == lane + FIRST_VEHICLE_ROW);
+	PROFILE_BEGIN(PROFILE_SCROLL_LANE);
+	uint8_t row = lane_row[lane];
+	FieldMask hits;
 	
 	// Work out the new lane position.
 	// Wrap numbers around if they go out of range
@@ -433,60 +352,72 @@ void scroll_vehicle_lane(uint8_t lane, int8_t direction) {
 	// start from a higher bit position in column 0
 	lane_position[lane] -= direction;
 	if(lane_position[lane] < 0) {
-		lane_position[lane] = LANE_DATA_WIDTH-1;
-	} else if(lane_position[lane] >= LANE_DATA_WIDTH) {
+		lane_position[lane] = pattern_length(LANE_PATTERN(lane))-1;
+	} else if(lane_position[lane] >= pattern_length(LANE_PATTERN(lane))) {
 		lane_position[lane] = 0;
 	}
-	// Update whether the frog will be alive or not. (The frog hasn't moved but
-	// it may have been hit by a vehicle.)
-	
-	// Show the lane on the display
-	redraw_traffic_lane(lane);
+	// Shift the death mask and add the column coming on to the display
+	// (column 0 when moving right, the last column when moving left)
+	scroll_death_mask(row, direction,
+			pattern_scroll(LANE_PATTERN(lane), direction));
 	
-	// If the frog is in this row, show it
-	if(frog_is_in_this_row) {
-		decrement = will_frog_die_at_position(frog_row, frog_column);
-		if (decrement) {
-			decrement_lives();
-		}
-		redraw_frog();
+	// The frogs haven't moved but they may have been hit by a vehicle.
+	// Every frog in this row is checked at once.
+	hits = death_mask[row] & frog_mask[row];
+	if(hits) {
+		frogs_hit(row, hits);
 	}
+	
+	// Show the lane (and any frogs in it) on the display
+	redraw_traffic_lane(lane);
+	redraw_frogs(row);
+	PROFILE_END(PROFILE_SCROLL_LANE);
 }
 
 
 void scroll_river_channel(uint8_t channel, int8_t direction) {
-	uint8_t frog_is_in_this_row = (frog_row == channel + FIRST_RIVER_ROW);
-	// Note, if the frog is in this row then it will be on a log
-	
-	if(frog_is_in_this_row) {
-		// Check if they're going to hit the edge - don't let the frog
-		// go beyond the edge
-		if(direction == 1 && frog_column == 15) {
-			decrement_lives(); // hit right edge
-		} else if(direction == -1 && frog_column == 0) {
-			decrement_lives(); // hit left edge
-		} else {
-			// Move the frog with the log - they're not going to hit the edge
-			frog_column += direction;
+	PROFILE_BEGIN(PROFILE_SCROLL_RIVER);
+	uint8_t row = channel_row[channel];
+	
+	// Note, any frogs in this row will be on a log. Move them with the
+	// log - unless they're going to hit the edge, which they can't go
+	// beyond.
+	if(frog_mask[row]) {
+		for(uint8_t frog = 0; frog < NUM_FROGS; frog++) {
+			if(frogs[frog].row != row || frogs[frog].hit) {
+				continue;
+			}
+			if((direction == 1 && frogs[frog].column == FIELD_COLUMNS - 1) ||
+					(direction == -1 && frogs[frog].column == 0)) {
+				frog_hit(frog); // hit the edge
+			} else {
+				frogs[frog].column += direction;
+			}
 		}
+		update_frog_mask(row);
 	}
 		
 	// Work out the new log position.
 	// Wrap numbers around if they go out of range
 	log_position[channel] -= direction;
 	if(log_position[channel] < 0) {
-		log_position[channel] = LOG_DATA_WIDTH-1;
-	} else if(log_position[channel] >= LOG_DATA_WIDTH) {
+		log_position[channel] = pattern_length(LOG_PATTERN(channel))-1;
+	} else if(log_position[channel] >= pattern_length(LOG_PATTERN(channel))) {
 		log_position[channel] = 0;
 	}
+	// The frog dies where there isn't a log
+	scroll_death_mask(row, direction,
+			!pattern_scroll(LOG_PATTERN(channel), direction));
 		
-	// Work out the log data to send to the display
+	// Work out the log data to send to the display, and put the frogs
+	// back on the logs
 	redraw_river_channel(channel);
-		
-	// If the frog is in this row, put them on the log
-	if(frog_is_in_this_row) {
-		redraw_frog();
-	}
+	redraw_frogs(row);
+	PROFILE_END(PROFILE_SCROLL_RIVER);
+}
+
+void frame_commit(void) {
+	ledmatrix_commit();
 }
 
 /////////////////////////////// Private (Helper) Functions /////////////////////
@@ -496,171 +427,306 @@ void scroll_river_channel(uint8_t channel, int8_t direction) {
 // a vehicle), or, if in the river, then it IS occupied by a log, or, if the final
 // riverbank then that space is free.
 static uint8_t will_frog_die_at_position(int8_t row, int8_t column) {
-	uint8_t lane, channel, bit_position;
-	if(column < 0 || column > 15) {
+	// Any position outside the game field means the frog will die
+	if(row < 0 || row > RIVERBANK_ROW || column < 0 || column >= FIELD_COLUMNS) {
 		return 1;
 	}
-	switch(row) {
-		case 0: // always safe
-		case 4: // always safe
-			return 0;
+	return (death_mask[row] >> column) & 1;
+}
+
+// Move a frog by the given number of rows and columns and show it there,
+// whether the move kills it or not. Returns 0 (and doesn't move the frog)
+// if the frog has already been hit.
+static uint8_t move_frog(uint8_t frog, int8_t rows, int8_t columns) {
+	Frog* f = &frogs[frog];
+	int8_t old_row = f->row;
+	
+	if(f->hit) {
+		return 0;
+	}
+	// Check whether this move will cause the frog to die or not
+	if(will_frog_die_at_position(f->row + rows, f->column + columns)) {
+		frog_hit(frog);
+	}
+	f->row += rows;
+	f->column += columns;
+	update_frog_mask(old_row);
+	update_frog_mask(f->row);
+	
+	// Redraw the row the frog was in (this will remove the frog but not
+	// any others there) and show the frog
+	redraw_row(old_row);
+	redraw_frogs(f->row);
+	
+	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
+	if(!f->hit && f->row == RIVERBANK_ROW) {
+		riverbank_status |= ((FieldMask)1 << f->column);
+		update_death_mask(RIVERBANK_ROW);
+	}
+	return 1;
+}
+
+// A frog has been hit (by a vehicle, the edge, water etc.). This costs a
+// life - unless another frog has already lost this one.
+static void frog_hit(uint8_t frog) {
+	frogs[frog].hit = 1;
+	if(!decrement) {
+		decrement = 1;
+		decrement_lives();
+	}
+}
+
+// The frogs in the given row that are in the columns of hits (bit n for
+// column n) have been hit.
+static void frogs_hit(uint8_t row, FieldMask hits) {
+	for(uint8_t frog = 0; frog < NUM_FROGS; frog++) {
+		if(frogs[frog].row == row && !frogs[frog].hit &&
+				((hits >> frogs[frog].column) & 1)) {
+			frog_hit(frog);
+		}
+	}
+}
+
+// Put all the frogs at the start, alive. Nothing is redrawn.
+static void reset_frogs(void) {
+	for(uint8_t frog = 0; frog < NUM_FROGS; frog++) {
+		frogs[frog].row = START_ROW;
+		frogs[frog].column = START_COLUMN(frog);
+		frogs[frog].hit = 0;
+	}
+	for(uint8_t row = 0; row < FIELD_ROWS; row++) {
+		update_frog_mask(row);
+	}
+}
+
+// Work out frog_mask for the given row from the frog positions. (Rows
+// and columns off the field are ignored.)
+static void update_frog_mask(int8_t row) {
+	FieldMask mask = 0;
+	
+	if(row < 0 || row >= FIELD_ROWS) {
+		return;
+	}
+	for(uint8_t frog = 0; frog < NUM_FROGS; frog++) {
+		if(frogs[frog].row == row && frogs[frog].column >= 0 &&
+				frogs[frog].column < FIELD_COLUMNS) {
+			mask |= ((FieldMask)1 << frogs[frog].column);
+		}
+	}
+	frog_mask[row] = mask;
+}
+
+// Return what the given row is (ROW_ROADSIDE etc.)
+static uint8_t row_role(uint8_t row) {
+	return pgm_read_byte(&row_roles[row]);
+}
+
+// Work out which row each traffic lane and river channel is in
+static void find_rows(void) {
+	uint8_t lane = 0, channel = 0;
+	for(uint8_t row = 0; row < FIELD_ROWS; row++) {
+		if(row_role(row) == ROW_ROAD && lane < NUM_TRAFFIC_LANES) {
+			row_lane[row] = lane;
+			lane_row[lane++] = row;
+		} else if(row_role(row) == ROW_RIVER && channel < NUM_RIVER_CHANNELS) {
+			row_lane[row] = channel;
+			channel_row[channel++] = row;
+		}
+	}
+}
+
+// Return the riverbank for the level, repeated across the whole field
+static FieldMask level_riverbank(void) {
+	FieldMask bank = 0;
+	for(uint8_t column = 0; column < FIELD_COLUMNS; column += 16) {
+		bank |= (FieldMask)current_level()->riverbank << column;
+	}
+	return bank;
+}
+
+// Work out the death masks for every row from scratch
+static void update_all_death_masks(void) {
+	for(uint8_t row = 0; row < FIELD_ROWS; row++) {
+		update_death_mask(row);
+	}
+}
+
+// Work out the death mask for the given row from scratch. This must be
+// called whenever a lane or log position is set (other than by scrolling)
+// and whenever riverbank_status changes.
+static void update_death_mask(uint8_t row) {
+	FieldMask mask = 0;
+	switch(row_role(row)) {
+		case ROW_ROADSIDE: // always safe
 			break;
-		case 1:
-		case 2:
-		case 3:
-			lane = row - 1;
-			bit_position = lane_position[lane] + column;
-			if(bit_position >= LANE_DATA_WIDTH) {
-				bit_position -= LANE_DATA_WIDTH;
-			}
-			return (lane_data[lane] >> bit_position) & 1;
+		case ROW_ROAD:
+			mask = pattern_window(LANE_PATTERN(row_lane[row]),
+					lane_position[row_lane[row]]);
 			break;
-		case 5:
-		case 6:
-			channel = row - 5;
-			bit_position = log_position[channel] + column;
-			if(bit_position >= LOG_DATA_WIDTH) {
-				bit_position -= LOG_DATA_WIDTH;
-			}
-			return !((log_data[channel] >> bit_position) & 1);
+		case ROW_RIVER:
+			// The frog dies where there isn't a log
+			mask = ~pattern_window(LOG_PATTERN(row_lane[row]),
+					log_position[row_lane[row]]) & FIELD_ALL_COLUMNS;
 			break;
-		case 7:
-			return (riverbank_status >> column) & 1;
-			break;	
+		case ROW_RIVERBANK:
+			// Riverbank edges and filled holes
+			mask = riverbank_status;
+			break;
+	}
+	death_mask[row] = mask;
+}
+
+// Update the death mask of a row whose lane or log has just scrolled one
+// column in the given direction. new_bit is whether the frog would die at
+// the column that has just come on to the display (column 0 if the
+// direction is 1 (right), the last column if the direction is -1 (left)).
+static void scroll_death_mask(uint8_t row, int8_t direction, uint8_t new_bit) {
+	if(direction > 0) {
+		death_mask[row] = ((death_mask[row] << 1) | new_bit) & FIELD_ALL_COLUMNS;
+	} else if(direction < 0) {
+		death_mask[row] = (death_mask[row] >> 1) | 
+				((FieldMask)new_bit << (FIELD_COLUMNS - 1));
+	}
+}
+
+// Set the lane and log positions to where they start for the level
+static void set_start_positions(void) {
+	const LevelSettings* level = current_level();
+	for(uint8_t lane = 0; lane < NUM_TRAFFIC_LANES; lane++) {
+		lane_position[lane] = level->lanes[lane].start;
+	}
+	for(uint8_t channel = 0; channel < NUM_RIVER_CHANNELS; channel++) {
+		log_position[channel] = level->channels[channel].start;
 	}
-	// Any row outside the valid range means the frog will die
-	return 1;	
 }
 
-// Redraw the rows on the game field. The frog is not redrawn.
+// Redraw the rows on the game field, and the frogs.
 static void redraw_whole_display(void) {
 	// Clear the display
 	ledmatrix_clear();
 	
-	// Start with the starting and halfway rows
-	redraw_roadside(START_ROW);
-	redraw_roadside(HALFWAY_ROW);
-
-	// Redraw traffic lanes
-	for(uint8_t lane=0; lane<=2; lane++) {
-		redraw_traffic_lane(lane);
-	}
-	// Redraw river
-	for(uint8_t channel=0; channel<=1; channel++) {
-		redraw_river_channel(channel);
+	for(uint8_t row = 0; row < FIELD_ROWS; row++) {
+		redraw_row(row);
 	}
-	// Redraw riverbank
-	redraw_riverbank();
 }
 
-// Redraw the row with the given number (0 to 7). The frog is not redrawn.
+// Redraw the row with the given number (0 to FIELD_ROWS-1), with the
+// frogs that are in it. (This is also how a frog that has moved is
+// removed from its old row.)
 static void redraw_row(uint8_t row) {	
-	// Remove frog from current position (we need to update the display
-	// so it shows the right colour pixel in its place). We know the frog
-	// must be either on a road edge, on the road or on a log.
-	switch(row) {
-		case START_ROW:
-		case HALFWAY_ROW:
+	if(row >= FIELD_ROWS) {
+		// Invalid row - ignore
+		return;
+	}
+	switch(row_role(row)) {
+		case ROW_ROADSIDE:
 			redraw_roadside(row);
 			break;
-		case FIRST_VEHICLE_ROW:
-		case SECOND_VEHICLE_ROW:
-		case THIRD_VEHICLE_ROW:
-			redraw_traffic_lane(row-1);
+		case ROW_ROAD:
+			redraw_traffic_lane(row_lane[row]);
 			break;
-		case FIRST_RIVER_ROW:
-		case SECOND_RIVER_ROW:
-			redraw_river_channel(row-5);
+		case ROW_RIVER:
+			redraw_river_channel(row_lane[row]);
 			break;
-		case RIVERBANK_ROW:
+		case ROW_RIVERBANK:
 			redraw_riverbank();
 			break;
-		default:
-			// Invalid row - ignore
-			break;
 	}
+	redraw_frogs(row);
 }
 
 
-// Redraw the given roadside row (0 or 4). The frog is not redrawn.
+// Redraw the given roadside row. The frogs are not redrawn.
 static void redraw_roadside(uint8_t row) {
 	MatrixRow row_display_data;
+	PixelColour edges = palette_colour(PALETTE_EDGES);
 	uint8_t i;
-	for(i=0;i<=15;i++) {
-		row_display_data[i] = COLOUR_EDGES;
+	for(i=0;i<FIELD_COLUMNS;i++) {
+		row_display_data[i] = edges;
 	}
-	ledmatrix_update_row(row, row_display_data);
+	ledmatrix_set_row(row, row_display_data);
 }
 
-// Redraw the given traffic lane (0, 1, 2). The frog is not redrawn.
+// Redraw the given traffic lane (0, 1, 2). The frogs are not redrawn.
 static void redraw_traffic_lane(uint8_t lane) {
 	MatrixRow row_display_data;
-	uint8_t i;
-	uint8_t bit_position = lane_position[lane];
-	for(i=0; i<=15; i++) {
-		if((lane_data[lane] >> bit_position) & 1) {
-			row_display_data[i] = vehicle_colours[lane];
-			} else {
-			row_display_data[i] = COLOUR_ROAD;
-		}
-		bit_position++;
-		if(bit_position >= LANE_DATA_WIDTH) {
-			// Wrap around in our lane data
-			bit_position = 0;
-		}
-	}
-	ledmatrix_update_row(lane+FIRST_VEHICLE_ROW, row_display_data);
+	render_mask(row_display_data, death_mask[lane_row[lane]],
+			palette_colour(PALETTE_VEHICLES(lane)), palette_colour(PALETTE_ROAD));
+	ledmatrix_set_row(lane_row[lane], row_display_data);
 }
 
-// Redraw the given river channel (0 or 1). The frog is not redrawn.
+// Redraw the given river channel (0 or 1). The frogs are not redrawn.
 static void redraw_river_channel(uint8_t channel) {
+	PROFILE_BEGIN(PROFILE_REDRAW_RIVER);
 	MatrixRow row_display_data;
-	uint8_t i;
-	uint8_t bit_position = log_position[channel];
-	for(i=0; i<=15; i++) {
-		if((log_data[channel] >> bit_position) & 1) {
-			row_display_data[i] = COLOUR_LOGS;
-			} else {
-			row_display_data[i] = COLOUR_WATER;
-		}
-		bit_position++;
-		if(bit_position >= LOG_DATA_WIDTH) {
-			bit_position = 0;
-		}
-	}
-	ledmatrix_update_row(channel+FIRST_RIVER_ROW, row_display_data);
+	// Logs are wherever the frog wouldn't die
+	render_mask(row_display_data, ~death_mask[channel_row[channel]],
+			palette_colour(PALETTE_LOGS), palette_colour(PALETTE_WATER));
+	ledmatrix_set_row(channel_row[channel], row_display_data);
+	PROFILE_END(PROFILE_REDRAW_RIVER);
 }
 
 // Redraw the riverbank (top row). Previous frogs which have made it to a hole
 // at the top are shown.
 static void redraw_riverbank(void) {
 	MatrixRow row_display_data;
+	PixelColour edges = palette_colour(PALETTE_EDGES);
+	PixelColour water = palette_colour(PALETTE_WATER);
 	uint8_t i;
 	// Blank out spaces in our rowdata where there are holes in the riverbank
-	for(i=0; i<= 15; i++) {
+	for(i=0; i<FIELD_COLUMNS; i++) {
 		if((riverbank >> i) & 1) {
 			// Riverbank edge
-			row_display_data[i] = COLOUR_EDGES;
+			row_display_data[i] = edges;
 		} else if ((riverbank_status >> i) & 1) {
 			// Frog occupying a hole
 			row_display_data[i] = COLOUR_FROG;
 		} else {
 			// Empty hole
-			row_display_data[i] = 0;
+			row_display_data[i] = water;
 		}
 	}
 	// Output our riverbank to the display
-	ledmatrix_update_row(RIVERBANK_ROW, row_display_data);
+	ledmatrix_set_row(RIVERBANK_ROW, row_display_data);
 }
 
-// Redraw the frog in its current position.
-static void redraw_frog(void) {
-	if(frog_dead) {
-		ledmatrix_update_pixel(frog_column, frog_row, COLOUR_DEAD_FROG);
-	} else if(decrement){
-		ledmatrix_update_pixel(frog_column, frog_row, COLOUR_DEAD_FROG);
-	} else {
-		ledmatrix_update_pixel(frog_column, frog_row, COLOUR_FROG);
+// Redraw the frogs in the given row. This only changes the shadow copy of
+// the display, so it costs nothing to send if the frogs haven't moved.
+// (Rows and columns off the field - where a frog that jumped off it is -
+// are ignored.)
+static void redraw_frogs(int8_t row) {
+	if(row < 0 || row >= FIELD_ROWS || !frog_mask[row]) {
+		return;
+	}
+	for(uint8_t frog = 0; frog < NUM_FROGS; frog++) {
+		if(frogs[frog].row != row || frogs[frog].column < 0 ||
+				frogs[frog].column >= FIELD_COLUMNS) {
+			continue;
+		}
+		if(frog_dead || frogs[frog].hit) {
+			ledmatrix_set_pixel(frogs[frog].column, row, COLOUR_DEAD_FROG);
+		} else {
+			ledmatrix_set_pixel(frogs[frog].column, row,
+					pgm_read_byte(&frog_colours[frog]));
+		}
 	}
 }
 
+// Fill in a row of pixels from a mask - set_colour where the bit for the
+// column is 1, clear_colour where it is 0. This works on 4 columns at a 
+// time without any branches: the select bytes pick out the bits of
+// (set_colour ^ clear_colour) that need to be flipped in clear_colour.
+static void render_mask(MatrixRow row_display_data, FieldMask mask, 
+		PixelColour set_colour, PixelColour clear_colour) {
+	uint8_t difference = set_colour ^ clear_colour;
+	PixelColour* pixel = row_display_data;
+	for(uint8_t nibble = 0; nibble < FIELD_COLUMNS / 4; nibble++) {
+		const uint8_t* selects = nibble_selects[mask & 0x0F];
+		pixel[0] = clear_colour ^ (pgm_read_byte(&selects[0]) & difference);
+		pixel[1] = clear_colour ^ (pgm_read_byte(&selects[1]) & difference);
+		pixel[2] = clear_colour ^ (pgm_read_byte(&selects[2]) & difference);
+		pixel[3] = clear_colour ^ (pgm_read_byte(&selects[3]) & difference);
+		pixel += 4;
+		mask >>= 4;
+	}
+}
@@ -10,74 +10,115 @@
  * where it is safe. It then has to cross a river by jumping
  * on to logs (rows 5 and 6) before jumping into into a hole
  * on the riverbank (row 7).
+ * (The field is as wide as the display - see field.h. Which rows are road,
+ * river etc. is set by a table in game.c.)
+ * There can be more than one frog on the field at once (see NUM_FROGS) -
+ * frogs are numbered from 0. The frogs share the lives, and when any frog
+ * is hit they all start the next life back on the roadside.
  *
- * The functions in this module will update the LED matrix
- * display as required. 
+ * The functions in this module draw on the LED matrix display as
+ * required, but nothing is sent to the display until frame_commit() is
+ * called. Everything drawn between two calls (e.g. a lane scrolling and a
+ * frog moving in the same row) goes to the display together, as the
+ * fewest commands that bring it up to date.
  */ 
 
 #ifndef GAME_H_
 #define GAME_H_
 
 #include <stdint.h>
-
-// Reset the game. Get the road and river ready and place a frog
+#include "field.h"
+
+// Number of frogs (players) on the field - 1 unless defined otherwise. Up
+// to MAX_FROGS: player 1 (frog 0) uses the push buttons and player 2
+// (frog 1) the serial terminal.
+#define MAX_FROGS 2
+#ifndef NUM_FROGS
+#define NUM_FROGS 1
+#endif
+#if NUM_FROGS < 1 || NUM_FROGS > MAX_FROGS
+#error "NUM_FROGS must be from 1 to MAX_FROGS"
+#endif
+
+// The row the frog finishes in (the top row)
+#define RIVERBANK_ROW (FIELD_ROWS - 1)
+
+// Reset the game. Get the road and river ready and place the frogs
 // on the roadside (bottom row)
 void initialise_game(void);
-void initialise_life(uint32_t level);
+// Reset the lanes for a new life (at the same level) and put the frogs
+// back on the roadside
+void initialise_life(void);
+// Load the given level from the level pack and reset the game field for it.
+// Nothing is drawn until show_level() is called, which draws the new
+// field and puts the frogs in their starting positions.
 void initialise_level(uint32_t level);
+void show_level(void);
 
-
-uint16_t riverbank_by_level(uint32_t level);
-
-// Add a frog to the game in the starting (bottom) row
+// Put the given frog back in its starting position in the bottom row
 // (This would typically be called after a frog has made it 
 // successfully to the other side.)
-void put_frog_in_start_position(void);
+void put_frog_in_start_position(uint8_t frog);
 
 /////////////////////////////////// MOVE FUNCTIONS /////////////////////////
-// is_frog_dead() should be checked after calling one of these to see
-// if the move succeeded or not
+// Each of these moves the given frog. is_decremented() should be checked
+// after calling one of these to see if the move succeeded or not. A frog
+// that has been hit doesn't move.
 
 // Move the frog one row forward.
 // This function must NOT be called if the frog is in row 7 (i.e. home).
 // Failure may occur if the frog jumps into a vehicle or jumps in the water 
 // or jumps into the riverbank. 
-void move_frog_forward(void);
+void move_frog_forward(uint8_t frog);
 
 // Move the frog one row backward, if possible.
-void move_frog_backward(void);
+void move_frog_backward(uint8_t frog);
 
 // Move the frog one column left. 
 // Failure may occur if the frog jumps into a vehicle or jumps off a log
 // into the river. Attempts to jump off the game field result in the frog dying.
-void move_frog_to_left(void);
+void move_frog_to_left(uint8_t frog);
 
 // Move the frog one column right.
 // Failure may occur if the frog jumps into a vehicle or jumps off a log
 // into the river. Attempts to jump off the game field result in the frog dying. 
-void move_frog_to_right(void);
+void move_frog_to_right(uint8_t frog);
 
 /////////////////////// FROG / GAME STATUS ///////////////////////////////////
-// Return the position of the frog. The row ranges from 0 (bottom) to 7 (top).
+// Return the position of the given frog. The row ranges from 0 (bottom) to 7 (top).
 // The column ranges from 0 (left hand side) to 1 (right hand side)
-uint8_t get_frog_row(void);
-uint8_t get_frog_column(void);
+uint8_t get_frog_row(uint8_t frog);
+uint8_t get_frog_column(uint8_t frog);
+
+// Return how far the given traffic lane (0 to 2) or log channel (0 or 1)
+// has scrolled - the column of the lane or log pattern shown in column 0.
+uint16_t get_lane_position(uint8_t lane);
+uint16_t get_log_position(uint8_t channel);
+
+// Return the columns of the given row (0 to FIELD_ROWS-1) where the frog
+// would die right now - bit n is 1 if the frog would die in column n.
+FieldMask get_death_mask(uint8_t row);
+
+// Return the number of the lane or log pattern (see levels.h) in the given
+// row, or -1 if the row is a roadside or the riverbank.
+int8_t get_row_pattern(uint8_t row);
 
 // Check whether the destination riverbank is full (i.e. there are frogs 
 // in all the holes).
 uint8_t is_riverbank_full(void);
 
-// Check whether the frog has reached the riverbank (the other side).
+// Check whether the given frog has reached the riverbank (the other side).
 // (If this returns true, the frog should not be moved any further.)
-uint8_t frog_has_reached_riverbank(void);
+uint8_t frog_has_reached_riverbank(uint8_t frog);
 
-// Check whether the frog is alive or dead
+// Check whether the frogs are out of lives (the game is over)
 uint8_t is_frog_dead(void);
 
 // Returns number of lives frog has left
 uint8_t num_frog_lives(void);
 
-// Checks whether life has been decremented
+// Checks whether life has been decremented (a frog has been hit) since
+// the start of this life
 uint8_t is_decremented(void);
 
 // Adjusts lives according to whether frog has died/leveled up
@@ -87,17 +128,21 @@ void init_led(void);
 
 /////////////////////// UPDATE FUNCTIONS /////////////////////////////////////
 // Scroll the given lane of traffic in the given direction. 
-// Check is_frog_dead() to determine whether the frog was killed or not.
+// Check is_decremented() to determine whether a frog was killed or not.
 // lane argument is 0, 1 or 2 corresponding to rows 1, 2 and 3 on the display.
 // direction argument is -1 for left, 1 for right, 0 for no scroll (just redraw)
 void scroll_vehicle_lane(uint8_t lane, int8_t direction);
 
-// Scroll the given log channel (and the frog if the frog is on a log) in
-// the given direction.
-// Check is_frog_dead() to determine whether the frog was killed or not.
+// Scroll the given log channel (and any frogs on its logs) in the given
+// direction.
+// Check is_decremented() to determine whether a frog was killed or not.
 // (Frog dies if it hits the edge of the game field whilst on a log.)
 // log argument is 0 or 1 (corresponding to rows 5 and 6 on the display).
 // direction argument is -1 for left, 1 for right, 0 for no scroll (just redraw)
 void scroll_river_channel (uint8_t channel, int8_t direction);
 
+// Send everything drawn since the last call to the LED matrix. Called once
+// each time through the main loop.
+void frame_commit(void);
+
 #endif /* GAME_H_ */
\ No newline at end of file
@@ -0,0 +1,177 @@
+/*
+ * high_scores.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <util/crc16.h>
+#include "high_scores.h"
+
+// One copy of the table as stored in a slot. (The scores come first so
+// there is no padding, whatever the compiler.)
+typedef struct {
+	uint32_t scores[NUM_HIGH_SCORES];	// best first, 0 for an empty place
+	uint16_t sequence;	// one more than the copy before
+	uint16_t crc;		// of everything above
+} HighScoreRecord;
+
+#define RECORD_SIZE (4 * NUM_HIGH_SCORES + 4)
+
+#if HIGH_SCORES_EEPROM_ADDRESS + HIGH_SCORE_SLOTS * RECORD_SIZE > E2END + 1
+#error "The high score slots don't fit in the EEPROM"
+#endif
+
+// The table as it is now
+static HighScoreRecord table;
+
+// The copy being written by the interrupt handler, the slot it is going
+// in (the slot of the latest copy when we aren't writing) and how many
+// bytes of it have been written. If the table changes while we are
+// writing, rewrite_pending is set and the handler starts on the next slot
+// when it finishes.
+static HighScoreRecord write_record;
+static uint8_t latest_slot;
+static uint8_t write_position;
+static volatile uint8_t writing;
+static uint8_t rewrite_pending;
+
+static void start_write(void);
+static uint8_t* slot_address(uint8_t slot);
+static uint16_t record_crc(const HighScoreRecord* record);
+
+void init_high_scores(void) {
+	HighScoreRecord record;
+	uint8_t found = 0;
+
+	for(uint8_t slot = 0; slot < HIGH_SCORE_SLOTS; slot++) {
+		eeprom_read_block(&record, slot_address(slot), RECORD_SIZE);
+		if(record.crc != record_crc(&record)) {
+			continue;
+		}
+		// Compare sequence numbers by their difference so it still works
+		// when they wrap around
+		if(!found || (int16_t)(record.sequence - table.sequence) > 0) {
+			table = record;
+			latest_slot = slot;
+			found = 1;
+		}
+	}
+	if(!found) {
+		for(uint8_t i = 0; i < NUM_HIGH_SCORES; i++) {
+			table.scores[i] = 0;
+		}
+		table.sequence = 0;
+		latest_slot = HIGH_SCORE_SLOTS - 1;
+	}
+	writing = 0;
+	rewrite_pending = 0;
+}
+
+int8_t add_high_score(uint32_t score) {
+	int8_t place;
+	uint8_t interrupts_enabled;
+
+	for(place = 0; place < NUM_HIGH_SCORES && score <= table.scores[place]; place++) {
+		;
+	}
+	if(score == 0 || place >= NUM_HIGH_SCORES) {
+		return -1;
+	}
+
+	// The interrupt handler may take a copy of the table, so it is changed
+	// with interrupts off (and then put back as they were)
+	interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	for(int8_t i = NUM_HIGH_SCORES - 1; i > place; i--) {
+		table.scores[i] = table.scores[i - 1];
+	}
+	table.scores[place] = score;
+	table.sequence++;
+	if(writing) {
+		rewrite_pending = 1;
+	} else {
+		start_write();
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+	return place;
+}
+
+uint32_t get_high_score(uint8_t place) {
+	return place < NUM_HIGH_SCORES ? table.scores[place] : 0;
+}
+
+void wait_for_high_scores_saved(void) {
+	// Sleep until each EEPROM ready interrupt (see idle_until_next_event()
+	// in project.c for why interrupts are off while we check)
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+	while(writing) {
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+	}
+	sei();
+}
+
+// Start writing the table to the next slot. Called with interrupts off.
+static void start_write(void) {
+	write_record = table;
+	write_record.crc = record_crc(&write_record);
+	latest_slot = (latest_slot + 1) % HIGH_SCORE_SLOTS;
+	write_position = 0;
+	rewrite_pending = 0;
+	writing = 1;
+	// The interrupt happens straight away if the EEPROM is ready
+	EECR |= (1<<EERIE);
+}
+
+// Write the next byte of the copy that differs from what is in the EEPROM
+// already (each write takes 3.3ms, after which this interrupt happens
+// again).
+ISR(EE_READY_vect) {
+	const uint8_t* data = (const uint8_t*)&write_record;
+	uint8_t* address;
+
+	while(write_position < RECORD_SIZE) {
+		address = slot_address(latest_slot) + write_position;
+		if(eeprom_read_byte(address) != data[write_position]) {
+			EEAR = (uintptr_t)address;
+			EEDR = data[write_position++];
+			// EEPE must be set within 4 clock cycles of EEMPE
+			EECR |= (1<<EEMPE);
+			EECR |= (1<<EEPE);
+			return;
+		}
+		write_position++;
+	}
+
+	// Finished this copy
+	if(rewrite_pending) {
+		start_write();
+	} else {
+		writing = 0;
+		EECR &= ~(1<<EERIE);
+	}
+}
+
+static uint8_t* slot_address(uint8_t slot) {
+	return (uint8_t*)(uintptr_t)(HIGH_SCORES_EEPROM_ADDRESS + slot * RECORD_SIZE);
+}
+
+static uint16_t record_crc(const HighScoreRecord* record) {
+	const uint8_t* data = (const uint8_t*)record;
+	uint16_t crc = 0xFFFF;
+
+	for(uint8_t i = 0; i < RECORD_SIZE - 2; i++) {
+		crc = _crc_ccitt_update(crc, data[i]);
+	}
+	return crc;
+}
@@ -0,0 +1,45 @@
+/*
+ * high_scores.h
+ *
+ * Author: Becca Vanneman
+ *
+ * The best NUM_HIGH_SCORES scores, kept in EEPROM so they survive a reset.
+ * Each time the table changes the whole table is written, with a sequence
+ * number, to the next of HIGH_SCORE_SLOTS slots in turn - so each EEPROM
+ * cell is only written once every HIGH_SCORE_SLOTS changes. At reset the
+ * slots are read once, in order, and the valid copy with the latest
+ * sequence number is used (a copy that was only partly written, e.g.
+ * because the power went, fails its CRC and the one before is used).
+ * Writing is done a byte at a time by the EEPROM ready interrupt handler,
+ * so adding a score never waits for the EEPROM (each byte takes 3.3ms).
+ */
+
+#ifndef HIGH_SCORES_H_
+#define HIGH_SCORES_H_
+
+#include <stdint.h>
+#include "input_log.h"
+
+#define NUM_HIGH_SCORES 5
+#define HIGH_SCORE_SLOTS 16
+
+// The slots go after the saved input log
+#define HIGH_SCORES_EEPROM_ADDRESS (INPUT_LOG_EEPROM_ADDRESS + INPUT_LOG_EEPROM_SIZE)
+
+// Load the latest high score table from EEPROM (an empty table if there
+// isn't one).
+void init_high_scores(void);
+
+// Add a score to the table if it is good enough. Returns its place in the
+// table (0 is the best) or -1 if it didn't make it. The table is saved to
+// EEPROM in the background.
+int8_t add_high_score(uint32_t score);
+
+// Return the score in the given place in the table (0 if there isn't one).
+uint32_t get_high_score(uint8_t place);
+
+// Wait until the table has been saved. The EEPROM can't be used for
+// anything else (e.g. input_log_save()) until then.
+void wait_for_high_scores_saved(void);
+
+#endif /* HIGH_SCORES_H_ */
@@ -0,0 +1,239 @@
+/*
+ * input.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include "input.h"
+#include "buttons.h"
+#include "serialio.h"
+#include "escape_sequence.h"
+#include "timer0.h"
+#include "input_log.h"
+#include "autopilot.h"
+
+// Number of characters we take from the serial input buffer at a time
+#define SERIAL_READ_CHUNK 16
+
+// Serial key presses we have decoded but not yet returned. Every waiting
+// character is decoded each time we are called (so the serial input buffer
+// can't fill up while the game is busy) and the actions are queued here.
+// If more than this many arrive at once the extras are dropped.
+#define SERIAL_ACTION_QUEUE_SIZE 8
+
+// Action for each button (B0 to B3)
+static const uint8_t button_actions[4] = {
+	INPUT_MOVE_RIGHT, INPUT_MOVE_BACKWARD, INPUT_MOVE_FORWARD, INPUT_MOVE_LEFT
+};
+
+// Buttons currently held down (bit n set for button n)
+static uint8_t buttons_held;
+
+// Auto repeat. When exactly one button is held, next_repeat_time is the
+// clock tick when it next generates an event and next_repeat_kind is
+// the kind of event (INPUT_HOLD the first time, INPUT_REPEAT after that)
+static uint16_t repeat_delay = INPUT_DEFAULT_REPEAT_DELAY;
+static uint16_t repeat_rate = INPUT_DEFAULT_REPEAT_RATE;
+static uint32_t next_repeat_time;
+static uint8_t next_repeat_kind;
+
+static uint8_t serial_actions[SERIAL_ACTION_QUEUE_SIZE];
+static uint32_t serial_action_times[SERIAL_ACTION_QUEUE_SIZE];
+static uint8_t serial_actions_head;
+static uint8_t num_serial_actions;
+
+static uint8_t get_live_input_event(InputEvent* event);
+static void discard_input(void);
+static void read_serial_input(void);
+static int8_t key_action(int16_t key);
+static uint8_t get_serial_input_event(InputEvent* event);
+static int8_t single_button_held(void);
+
+void init_input(void) {
+	buttons_held = 0;
+	num_serial_actions = 0;
+	escape_sequence_reset();
+	while(button_pushed() != NO_BUTTON_PUSHED) {
+		; // discard
+	}
+	clear_serial_input_buffer();
+}
+
+void set_input_repeat(uint16_t initial_delay, uint16_t rate) {
+	repeat_delay = initial_delay;
+	repeat_rate = rate;
+}
+
+uint8_t get_input_event(InputEvent* event) {
+	uint32_t now = get_current_time();
+	
+	if(input_log_replaying()) {
+		discard_input();
+		return input_log_next(event, now);
+	}
+	if(get_live_input_event(event) || autopilot_next(event, get_game_time())) {
+		input_log_record(event, now);
+		return 1;
+	}
+	return 0;
+}
+
+uint8_t input_waiting(void) {
+	uint32_t now = get_current_time();
+	
+	if(input_log_replaying()) {
+		return input_log_event_due(now);
+	}
+	return num_serial_actions != 0 || button_pushes_waiting() != 0 ||
+			serial_input_available() || autopilot_event_due(get_game_time());
+}
+
+// Get the next event from the buttons or serial input
+static uint8_t get_live_input_event(InputEvent* event) {
+	ButtonEvent button_event;
+	int8_t button;
+
+	// Pick up any button that has stopped bouncing since the last
+	// pin change interrupt
+	update_button_state();
+	read_serial_input();
+
+	while(get_button_event(&button_event)) {
+		if(button_event.pressed) {
+			buttons_held |= (1<<button_event.button);
+		} else {
+			buttons_held &= ~(1<<button_event.button);
+		}
+		// Any change restarts the auto repeat delay (for whichever
+		// button is still held, if exactly one is). The repeat runs on
+		// game time, so it stops while the game is paused.
+		next_repeat_time = get_game_time() - (get_current_time() - button_event.time) +
+				repeat_delay;
+		next_repeat_kind = INPUT_HOLD;
+		if(button_event.pressed) {
+			event->action = button_actions[button_event.button];
+			event->kind = INPUT_PRESS;
+			event->source = INPUT_FROM_BUTTON;
+			event->time = button_event.time;
+			return 1;
+		}
+	}
+
+	if(get_serial_input_event(event)) {
+		return 1;
+	}
+
+	// Auto repeat - only when a single button is held down. If multiple
+	// buttons are held we ignore them all.
+	button = single_button_held();
+	if(button >= 0) {
+		uint32_t now = get_game_time();
+		if(time_after_eq(now, next_repeat_time)) {
+			event->action = button_actions[button];
+			event->kind = next_repeat_kind;
+			event->source = INPUT_FROM_BUTTON;
+			event->time = get_current_time();
+			next_repeat_kind = INPUT_REPEAT;
+			next_repeat_time += repeat_rate;
+			if(time_after_eq(now, next_repeat_time)) {
+				// We've fallen behind - don't try to catch up
+				next_repeat_time = now + repeat_rate;
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Throw away any button or serial input (while a game is being replayed)
+static void discard_input(void) {
+	ButtonEvent button_event;
+	
+	update_button_state();
+	read_serial_input();
+	while(get_button_event(&button_event)) {
+		; // discard
+	}
+	buttons_held = 0;
+	num_serial_actions = 0;
+}
+
+// Decode every character waiting in the serial input buffer and queue
+// the actions for any keys we use
+static void read_serial_input(void) {
+	char buffer[SERIAL_READ_CHUNK];
+	uint8_t count;
+	uint32_t now = get_current_time();
+
+	while((count = serial_read(buffer, SERIAL_READ_CHUNK)) > 0) {
+		for(uint8_t i = 0; i < count; i++) {
+			int8_t action = key_action(escape_sequence_feed(buffer[i]));
+			if(action < 0 || num_serial_actions >= SERIAL_ACTION_QUEUE_SIZE) {
+				continue;
+			}
+			uint8_t pos = (serial_actions_head + num_serial_actions) 
+					% SERIAL_ACTION_QUEUE_SIZE;
+			serial_actions[pos] = action;
+			serial_action_times[pos] = now;
+			num_serial_actions++;
+		}
+	}
+}
+
+// Return the action for a key (as returned by escape_sequence_feed()), or
+// -1 if it isn't a key we use
+static int8_t key_action(int16_t key) {
+	switch(key) {
+		case KEY_LEFT: case 'L': case 'l':
+			return INPUT_MOVE_LEFT;
+		case KEY_UP: case 'U': case 'u':
+			return INPUT_MOVE_FORWARD;
+		case KEY_DOWN: case 'D': case 'd':
+			return INPUT_MOVE_BACKWARD;
+		case KEY_RIGHT: case 'R': case 'r':
+			return INPUT_MOVE_RIGHT;
+		case 'P': case 'p':
+			return INPUT_PAUSE;
+		case 'S': case 's':
+			return INPUT_SAFE_DISPLAY;
+		case 'T': case 't':
+			return INPUT_TELEMETRY;
+		case '?':
+			return INPUT_PROFILE;
+		case '!':
+			return INPUT_REPLAY;
+		case '#':
+			return INPUT_DUMP_LOG;
+		case 'E': case 'e':
+			return INPUT_SAVE_LOG;
+		case 'A': case 'a':
+			return INPUT_AUTOPILOT;
+		default:
+			return -1;
+	}
+}
+
+// Return the oldest queued serial key press. Returns 1 and fills in *event
+// if there was one.
+static uint8_t get_serial_input_event(InputEvent* event) {
+	if(num_serial_actions == 0) {
+		return 0;
+	}
+	event->action = serial_actions[serial_actions_head];
+	event->kind = INPUT_PRESS;
+	event->source = INPUT_FROM_SERIAL;
+	event->time = serial_action_times[serial_actions_head];
+	serial_actions_head = (serial_actions_head + 1) % SERIAL_ACTION_QUEUE_SIZE;
+	num_serial_actions--;
+	return 1;
+}
+
+// Return the button number if exactly one button is held, otherwise -1
+static int8_t single_button_held(void) {
+	for(uint8_t button = 0; button <= 3; button++) {
+		if(buttons_held == (1<<button)) {
+			return button;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,84 @@
+/*
+ * input.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Combines push button and serial input into one stream of input events.
+ * Buttons B0 to B3 and the serial port (arrow keys, or the letters L, R,
+ * U and D) both move the frog. P pauses, S slows the LED matrix down to a
+ * safe speed, T switches between the terminal display and telemetry and ?
+ * prints the profiler statistics (if compiled in). On the splash and game
+ * over screens ! replays the last game, # prints its input log and E saves
+ * the log to EEPROM (see input_log.h). In a game A lets the autopilot play
+ * player 1 (see autopilot.h), whose moves come in as input events too.
+ * If a single button is held down it generates a hold event after an
+ * initial delay and then repeat events at a fixed rate. All timing comes
+ * from the time stamps on the button events so it doesn't depend on how
+ * often we are called.
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stdint.h>
+
+// What the input asks for
+#define INPUT_MOVE_LEFT		0
+#define INPUT_MOVE_RIGHT	1
+#define INPUT_MOVE_FORWARD	2
+#define INPUT_MOVE_BACKWARD	3
+#define INPUT_PAUSE			4
+#define INPUT_SAFE_DISPLAY	5
+#define INPUT_TELEMETRY		6	// switch between the terminal display and telemetry
+#define INPUT_PROFILE		7	// print the profiler statistics
+#define INPUT_REPLAY		8	// replay the last game
+#define INPUT_DUMP_LOG		9	// print the input log
+#define INPUT_SAVE_LOG		10	// save the input log to EEPROM
+#define INPUT_AUTOPILOT		11	// turn the autopilot on or off
+
+// Kinds of input event
+#define INPUT_PRESS		0	// button pushed or key typed
+#define INPUT_HOLD		1	// button held for the initial delay
+#define INPUT_REPEAT	2	// button still held after another repeat period
+
+// Where the input came from
+#define INPUT_FROM_BUTTON	0
+#define INPUT_FROM_SERIAL	1
+#define INPUT_FROM_AUTOPILOT	2	// moves player 1 like the buttons do
+
+typedef struct {
+	uint8_t action;
+	uint8_t kind;
+	uint8_t source;
+	uint32_t time;	// clock tick when it happened (see get_current_time())
+} InputEvent;
+
+// Default auto repeat timing (ms)
+#define INPUT_DEFAULT_REPEAT_DELAY 300
+#define INPUT_DEFAULT_REPEAT_RATE 300
+
+// Reset the input state (no buttons held, no partial escape sequence)
+// and discard any waiting input (including queued serial key presses).
+// Auto repeat timing is not changed.
+void init_input(void);
+
+// Set how long a button must be held before it starts repeating, and the
+// time between repeats after that (both in ms).
+void set_input_repeat(uint16_t initial_delay, uint16_t repeat_rate);
+
+// Get the next input event. Returns 1 and fills in *event if there was
+// one, 0 otherwise. Button input takes priority over serial input, and
+// both take priority over the autopilot.
+// Events are added to the input log. While a game is being replayed the
+// events come from the log instead, and button and serial input is
+// thrown away.
+uint8_t get_input_event(InputEvent* event);
+
+// Return 1 if there is input waiting that get_input_event() has not dealt
+// with yet (button events, serial characters or queued key presses).
+// Auto repeats are not included, but a move the autopilot is due to make
+// is. While a game is being replayed, returns 1 if the next logged event
+// is due. Safe to call with interrupts off.
+uint8_t input_waiting(void);
+
+#endif /* INPUT_H_ */
@@ -0,0 +1,215 @@
+/*
+ * input_log.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include <stdio.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include "input_log.h"
+#include "serialio.h"
+#include "timer0.h"
+
+#if INPUT_LOG_SIZE > 255
+#error "INPUT_LOG_SIZE can't be more than 255"
+#endif
+
+// Longest line printed by input_log_dump()
+#define DUMP_LINE_LENGTH 40
+
+// Each entry in the log is the time (ms) since the previous entry (or the
+// start of the game) and the event packed into a byte - the action in
+// bits 0 to 3, the kind in bits 4 and 5 and the source in bits 6 and 7
+// (which can't make NO_EVENT as there are only 3 kinds). Gaps of
+// more than 0xFFFF ms are made up with NO_EVENT entries.
+#define EVENT_ACTION_MASK	0x0F
+#define EVENT_KIND_SHIFT	4
+#define EVENT_KIND_MASK		0x03
+#define EVENT_SOURCE_SHIFT	6
+#define NO_EVENT			0xFF
+#define MAX_DELAY			0xFFFF
+
+static uint16_t log_delays[INPUT_LOG_SIZE];
+static uint8_t log_events[INPUT_LOG_SIZE];
+static uint8_t log_length;
+static uint8_t log_truncated;	// 1 if the game had more events than we could keep
+static uint8_t have_log;		// 1 if the log holds a game (which may have no events)
+
+// What we are doing with the log
+#define LOG_IDLE		0
+#define LOG_RECORDING	1
+#define LOG_REPLAYING	2
+static uint8_t log_state;
+static uint8_t replay_next_game;
+
+// Time of the last entry recorded or replayed (or the start of the game),
+// and the next entry to replay
+static uint32_t last_entry_time;
+static uint8_t replay_position;
+
+// Layout of the saved log in EEPROM: the number of entries, the truncated
+// flag, a CRC of both and the entries, then the delays and the events. An
+// erased EEPROM (all 0xFF) has too many entries so isn't taken for a log.
+#define EEPROM_LENGTH		((uint8_t*)INPUT_LOG_EEPROM_ADDRESS)
+#define EEPROM_TRUNCATED	((uint8_t*)(INPUT_LOG_EEPROM_ADDRESS + 1))
+#define EEPROM_CRC			((uint16_t*)(INPUT_LOG_EEPROM_ADDRESS + 2))
+#define EEPROM_DELAYS		((uint16_t*)(INPUT_LOG_EEPROM_ADDRESS + 4))
+#define EEPROM_EVENTS		((uint8_t*)(INPUT_LOG_EEPROM_ADDRESS + 4 + 2 * INPUT_LOG_SIZE))
+
+// Key for each action and names for each kind of event, for the dump
+static const char action_keys[] PROGMEM = "LRUDPST?!#EA";
+static const char source_names[] PROGMEM = "BSA";
+static const char press_name[] PROGMEM = "press";
+static const char hold_name[] PROGMEM = "hold";
+static const char repeat_name[] PROGMEM = "repeat";
+static PGM_P const kind_names[] PROGMEM = {
+	press_name, hold_name, repeat_name
+};
+
+static uint8_t add_entry(uint16_t delay, uint8_t event);
+static uint16_t log_crc(void);
+
+void init_input_log(void) {
+	log_state = LOG_IDLE;
+	replay_next_game = 0;
+	have_log = 0;
+	log_length = eeprom_read_byte(EEPROM_LENGTH);
+	log_truncated = eeprom_read_byte(EEPROM_TRUNCATED);
+	if(log_length <= INPUT_LOG_SIZE) {
+		eeprom_read_block(log_delays, EEPROM_DELAYS, 2 * log_length);
+		eeprom_read_block(log_events, EEPROM_EVENTS, log_length);
+		have_log = (eeprom_read_word(EEPROM_CRC) == log_crc());
+	}
+	if(!have_log) {
+		log_length = 0;
+		log_truncated = 0;
+	}
+}
+
+void input_log_start_game(uint32_t now) {
+	last_entry_time = now;
+	if(replay_next_game) {
+		replay_next_game = 0;
+		replay_position = 0;
+		log_state = LOG_REPLAYING;
+	} else {
+		log_length = 0;
+		log_truncated = 0;
+		have_log = 1;
+		log_state = LOG_RECORDING;
+	}
+}
+
+void input_log_end_game(void) {
+	log_state = LOG_IDLE;
+}
+
+uint8_t input_log_replay_next_game(void) {
+	replay_next_game = have_log;
+	return have_log;
+}
+
+uint8_t input_log_replaying(void) {
+	return log_state == LOG_REPLAYING;
+}
+
+void input_log_record(const InputEvent* event, uint32_t now) {
+	uint32_t delay = now - last_entry_time;
+
+	if(log_state != LOG_RECORDING || log_truncated) {
+		return;
+	}
+	last_entry_time = now;
+	while(delay > MAX_DELAY) {
+		if(!add_entry(MAX_DELAY, NO_EVENT)) {
+			return;
+		}
+		delay -= MAX_DELAY;
+	}
+	add_entry(delay, event->action | (event->kind << EVENT_KIND_SHIFT) |
+			(event->source << EVENT_SOURCE_SHIFT));
+}
+
+uint8_t input_log_event_due(uint32_t now) {
+	return log_state == LOG_REPLAYING && replay_position < log_length &&
+			time_after_eq(now, last_entry_time + log_delays[replay_position]);
+}
+
+uint8_t input_log_next(InputEvent* event, uint32_t now) {
+	uint8_t packed;
+
+	while(input_log_event_due(now)) {
+		// Times are kept from when each entry was due rather than when we
+		// got to it, so a slow loop doesn't push the later events back
+		last_entry_time += log_delays[replay_position];
+		packed = log_events[replay_position++];
+		if(packed != NO_EVENT) {
+			event->action = packed & EVENT_ACTION_MASK;
+			event->kind = (packed >> EVENT_KIND_SHIFT) & EVENT_KIND_MASK;
+			event->source = packed >> EVENT_SOURCE_SHIFT;
+			event->time = last_entry_time;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void input_log_dump(void) {
+	uint32_t time = 0;
+	uint8_t packed;
+
+	serial_wait_for_output_space(DUMP_LINE_LENGTH);
+	printf_P(PSTR("\nInput log: %u events%S\n"), log_length,
+			log_truncated ? PSTR(" (more were lost)") : PSTR(""));
+	for(uint8_t i = 0; i < log_length; i++) {
+		time += log_delays[i];
+		packed = log_events[i];
+		if(packed == NO_EVENT) {
+			continue;
+		}
+		serial_wait_for_output_space(DUMP_LINE_LENGTH);
+		printf_P(PSTR("%8lu %c %c %S\n"), time,
+				pgm_read_byte(&source_names[packed >> EVENT_SOURCE_SHIFT]),
+				pgm_read_byte(&action_keys[packed & EVENT_ACTION_MASK]),
+				(PGM_P)pgm_read_word(&kind_names[(packed >> EVENT_KIND_SHIFT) & EVENT_KIND_MASK]));
+	}
+}
+
+void input_log_save(void) {
+	eeprom_update_block(log_delays, EEPROM_DELAYS, 2 * log_length);
+	eeprom_update_block(log_events, EEPROM_EVENTS, log_length);
+	eeprom_update_byte(EEPROM_TRUNCATED, log_truncated);
+	eeprom_update_word(EEPROM_CRC, log_crc());
+	// The length goes last so a log that is only partly written (e.g. if
+	// the power goes) fails the CRC check
+	eeprom_update_byte(EEPROM_LENGTH, log_length);
+}
+
+// Add an entry to the end of the log. Returns 0 (and marks the log as
+// truncated) if the log is full.
+static uint8_t add_entry(uint16_t delay, uint8_t event) {
+	if(log_length >= INPUT_LOG_SIZE) {
+		log_truncated = 1;
+		return 0;
+	}
+	log_delays[log_length] = delay;
+	log_events[log_length] = event;
+	log_length++;
+	return 1;
+}
+
+// CRC of the log (the length, truncated flag and entries) as saved in EEPROM
+static uint16_t log_crc(void) {
+	uint16_t crc = 0xFFFF;
+
+	crc = _crc_ccitt_update(crc, log_length);
+	crc = _crc_ccitt_update(crc, log_truncated);
+	for(uint8_t i = 0; i < log_length; i++) {
+		crc = _crc_ccitt_update(crc, log_delays[i] & 0xFF);
+		crc = _crc_ccitt_update(crc, log_delays[i] >> 8);
+		crc = _crc_ccitt_update(crc, log_events[i]);
+	}
+	return crc;
+}
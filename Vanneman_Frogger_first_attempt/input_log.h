@@ -0,0 +1,73 @@
+/*
+ * input_log.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Records the input events of a game (see input.h) so that the game can
+ * be played again exactly. Each event is kept with the time (in clock
+ * ticks) since the game started. When a game is replayed, get_input_event()
+ * returns the logged events at the same times instead of reading the
+ * buttons and serial port. With the same levels (see set_level_generator())
+ * a replayed game sends the same SPI and serial traffic as the original,
+ * as long as the main loop keeps up with the clock - so different builds
+ * can be timed playing the same game, on the board or in the host
+ * simulation.
+ * The log in RAM holds the last game played. It can be printed over the
+ * serial port or saved to EEPROM, and a saved log is loaded at reset. If a
+ * game has more than INPUT_LOG_SIZE events the log only holds the first
+ * INPUT_LOG_SIZE, and a replay carries on without input after that.
+ */
+
+#ifndef INPUT_LOG_H_
+#define INPUT_LOG_H_
+
+#include <stdint.h>
+#include "input.h"
+
+// Number of events the log holds (each takes 3 bytes of RAM and EEPROM)
+#ifndef INPUT_LOG_SIZE
+#define INPUT_LOG_SIZE 64
+#endif
+
+// Where the saved log goes in EEPROM, and how much room it takes
+#define INPUT_LOG_EEPROM_ADDRESS 0
+#define INPUT_LOG_EEPROM_SIZE (4 + 3 * INPUT_LOG_SIZE)
+
+// Load the log saved in EEPROM, if there is one.
+void init_input_log(void);
+
+// Start logging a new game, which started at the given time. If
+// input_log_replay_next_game() has been called the game is replayed from
+// the log instead.
+void input_log_start_game(uint32_t now);
+
+// Stop logging (or replaying) at the end of a game.
+void input_log_end_game(void);
+
+// Replay the log in the next game (from input_log_start_game()). Returns
+// 0 if there is no log to replay.
+uint8_t input_log_replay_next_game(void);
+
+// Return 1 if a game is being replayed.
+uint8_t input_log_replaying(void);
+
+// Add an event to the log if a game is being logged. now is the time the
+// event was dealt with.
+void input_log_record(const InputEvent* event, uint32_t now);
+
+// Return 1 if the next event of the game being replayed is due. Safe to
+// call with interrupts off.
+uint8_t input_log_event_due(uint32_t now);
+
+// Get the next event of the game being replayed, if it is due. Returns 1
+// and fills in *event if there was one, 0 otherwise.
+uint8_t input_log_next(InputEvent* event, uint32_t now);
+
+// Print the log on the serial terminal, one event per line.
+void input_log_dump(void);
+
+// Save the log to EEPROM. This waits for the EEPROM writes to finish
+// (a few ms per byte) so should not be done while a game is being played.
+void input_log_save(void);
+
+#endif /* INPUT_LOG_H_ */
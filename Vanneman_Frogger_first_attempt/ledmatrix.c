@@ -7,6 +7,7 @@
  */ 
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "ledmatrix.h"
 #include "spi.h"
 
@@ -17,19 +18,133 @@
 #define CMD_SHIFT_DISPLAY 0x04
 #define CMD_CLEAR_SCREEN 0x0F
 
+// Shift a single row, filling the column shifted in with the given colour.
+// Not supported by all LED matrix firmware - see
+// ledmatrix_set_row_shift_supported().
+#define CMD_SHIFT_ROW 0x05
+
+/* System clock rate in Hz. (L at the end indicates this is a long constant) */
+#define SYSCLK 8000000L
+
+// SPI clock dividers. The LED matrix can always keep up with a divider of
+// 128. At LEDMATRIX_FAST_SPI_DIVIDER (8 or 16) bytes arrive faster than the
+// LED matrix can process a continuous stream of them, so we also limit the
+// average rate to MATRIX_MAX_BYTES_PER_MS. (At 128 the bus itself sends
+// fewer than 8 bytes per millisecond.) Define LEDMATRIX_SAFE_SPI to always
+// use the slow speed.
+#define SAFE_SPI_DIVIDER 128
+#ifndef LEDMATRIX_FAST_SPI_DIVIDER
+#define LEDMATRIX_FAST_SPI_DIVIDER 16
+#endif
+#define MATRIX_MAX_BYTES_PER_MS 24
+
+// Number of bytes sent over SPI by each command (to one panel)
+#define UPDATE_ALL_BYTES (1 + MATRIX_PANEL_ROWS * MATRIX_PANEL_COLUMNS)
+#define UPDATE_ROW_BYTES (2 + MATRIX_PANEL_COLUMNS)
+#define UPDATE_PIXEL_BYTES 3
+#define SHIFT_ROW_BYTES 3
+
+// Ways of sending a dirty row on commit
+#define SEND_NOTHING 0
+#define SEND_PIXELS 1
+#define SEND_ROW 2
+#define SEND_SHIFT_LEFT 3
+#define SEND_SHIFT_RIGHT 4
+
+// The panel showing a display position, and the first (left hand) column
+// and first (bottom) row of a panel. Commands sent to a panel use
+// positions within the panel - as the panels are 16 x 8 these are just
+// the bottom 4 bits of x and the bottom 3 bits of y.
+#define PANEL_AT(x, y) (((y) / MATRIX_PANEL_ROWS) * LEDMATRIX_PANELS_ACROSS + \
+		(x) / MATRIX_PANEL_COLUMNS)
+#define PANEL_FIRST_COLUMN(panel) (((panel) % LEDMATRIX_PANELS_ACROSS) * MATRIX_PANEL_COLUMNS)
+#define PANEL_FIRST_ROW(panel) (((panel) / LEDMATRIX_PANELS_ACROSS) * MATRIX_PANEL_ROWS)
+
+// Slave select pins for the panels (port D, active low)
+#define PANEL_SELECT_PINS (((1 << MATRIX_NUM_PANELS) - 1) << LEDMATRIX_FIRST_SELECT_PIN)
+#if MATRIX_NUM_PANELS > 1 && LEDMATRIX_FIRST_SELECT_PIN + MATRIX_NUM_PANELS > 8
+#error "Not enough port D pins for the panel slave selects"
+#endif
+
+// Shadow copies of the display. pending_frame is what the display should
+// show once ledmatrix_commit() is called. sent_frame is what we last sent
+// to the LED matrix. dirty_rows[panel] has bit n set if row n of that
+// panel (counting from the bottom of the panel) of pending_frame may
+// differ from sent_frame.
+#if MATRIX_NUM_PANELS > 2 && !defined(LEDMATRIX_ALLOW_LARGE_DISPLAY)
+#error "The shadow copies for more than two panels need too much RAM"
+#endif
+static MatrixData pending_frame;
+static MatrixData sent_frame;
+static uint8_t dirty_rows[MATRIX_NUM_PANELS];
+
+#if MATRIX_NUM_PANELS > 1
+// Panel whose slave select is low
+static uint8_t selected_panel;
+#endif
+
+// Whether the LED matrix firmware understands CMD_SHIFT_ROW.
+#ifdef LEDMATRIX_HAS_ROW_SHIFT
+static uint8_t row_shift_supported = 1;
+#else
+static uint8_t row_shift_supported = 0;
+#endif
+
+static void select_panel(uint8_t panel);
+static void send_panel(uint8_t panel, MatrixData data);
+static void mark_row_dirty(uint8_t y);
+static void send_row(uint8_t y, MatrixData data);
+static void shift_display(uint8_t direction);
+static void commit_panel(uint8_t panel);
+static void send_panel_row(uint8_t panel, uint8_t y);
+static void send_changed_pixels(uint8_t panel, uint8_t y);
+static void send_row_shift(uint8_t panel, uint8_t y, int8_t direction);
+static uint8_t changes_after_row_shift(uint8_t panel, uint8_t y, int8_t direction);
+static void shift_row(MatrixData data, uint8_t first_x, uint8_t last_x, uint8_t y,
+		int8_t direction, PixelColour fill);
+static void shift_frame(MatrixData data, uint8_t direction);
+
 void ledmatrix_setup(void) {
+#if MATRIX_NUM_PANELS > 1
+	// All panels deselected except the first
+	DDRD |= PANEL_SELECT_PINS;
+	PORTD = (PORTD | PANEL_SELECT_PINS) & ~(1 << LEDMATRIX_FIRST_SELECT_PIN);
+	selected_panel = 0;
+#endif
+#ifdef LEDMATRIX_SAFE_SPI
+	ledmatrix_use_safe_spi_speed();
+#else
+	// Setup SPI - we divide the clock by LEDMATRIX_FAST_SPI_DIVIDER and
+	// limit how many bytes are sent each millisecond so that the LED
+	// matrix's SPI buffer can't overflow. The limit is whichever is lower
+	// of the rate the bus can actually send bytes at with this divider and
+	// the rate the LED matrix can process them.
+	uint16_t bus_bytes_per_ms = SYSCLK / 1000 / 8 / LEDMATRIX_FAST_SPI_DIVIDER;
+	if(bus_bytes_per_ms > MATRIX_MAX_BYTES_PER_MS) {
+		bus_bytes_per_ms = MATRIX_MAX_BYTES_PER_MS;
+	}
+	spi_set_rate_limit(bus_bytes_per_ms);
+	spi_setup_master(LEDMATRIX_FAST_SPI_DIVIDER);
+#endif
+}
+
+void ledmatrix_use_safe_spi_speed(void) {
 	// Setup SPI - we divide the clock by 128.
 	// (This speed guarantees the SPI buffer will never overflow on
-	// the LED matrix.)
-	spi_setup_master(128);
+	// the LED matrix.) We wait for anything queued at the old speed to be
+	// sent first.
+	spi_flush();
+	spi_set_rate_limit(0);
+	spi_setup_master(SAFE_SPI_DIVIDER);
+}
+
+void ledmatrix_repaint(void) {
+	ledmatrix_update_all(pending_frame);
 }
 
 void ledmatrix_update_all(MatrixData data) {
-	(void)spi_send_byte(CMD_UPDATE_ALL);
-	for(uint8_t y=0; y<MATRIX_NUM_ROWS; y++) {
-		for(uint8_t x=0; x<MATRIX_NUM_COLUMNS; x++) {
-			(void)spi_send_byte(data[x][y]);
-		}
+	for(uint8_t panel = 0; panel < MATRIX_NUM_PANELS; panel++) {
+		send_panel(panel, data);
 	}
 }
 
@@ -38,9 +153,11 @@ void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
 		// Position isn't valid - we ignore the request.
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_PIXEL);
-	(void)spi_send_byte( ((y & 0x07)<<4) | (x & 0x0F));
-	(void)spi_send_byte(pixel);
+	select_panel(PANEL_AT(x, y));
+	spi_queue_byte(CMD_UPDATE_PIXEL);
+	spi_queue_byte( ((y & 0x07)<<4) | (x & 0x0F));
+	spi_queue_byte(pixel);
+	pending_frame[x][y] = sent_frame[x][y] = pixel;
 }
 
 void ledmatrix_update_row(uint8_t y, MatrixRow row) {
@@ -48,10 +165,15 @@ void ledmatrix_update_row(uint8_t y, MatrixRow row) {
 		// y value is too large - we ignore the request
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_ROW);
-	(void)spi_send_byte(y & 0x07);	// row number
-	for(uint8_t x = 0; x<MATRIX_NUM_COLUMNS; x++) {
-		(void)spi_send_byte(row[x]);
+	// Each panel along the row gets its part of the row
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		if((x & 0x0F) == 0) {
+			select_panel(PANEL_AT(x, y));
+			spi_queue_byte(CMD_UPDATE_ROW);
+			spi_queue_byte(y & 0x07);	// row number
+		}
+		spi_queue_byte(row[x]);
+		pending_frame[x][y] = sent_frame[x][y] = row[x];
 	}
 }
 
@@ -60,37 +182,123 @@ void ledmatrix_update_column(uint8_t x, MatrixColumn col) {
 		// x value is too large - we ignore the request
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_COL);
-	(void)spi_send_byte(x & 0x0F); // column number
+	// Each panel up the column gets its part of the column
 	for(uint8_t y = 0; y<MATRIX_NUM_ROWS; y++) {
-		(void)spi_send_byte(col[y]);
+		if((y & 0x07) == 0) {
+			select_panel(PANEL_AT(x, y));
+			spi_queue_byte(CMD_UPDATE_COL);
+			spi_queue_byte(x & 0x0F); // column number
+		}
+		spi_queue_byte(col[y]);
+		pending_frame[x][y] = sent_frame[x][y] = col[y];
 	}
 }
 
 void ledmatrix_shift_display_left(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x02);
+	shift_display(0x02);
 }
 
 void ledmatrix_shift_display_right(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x01);
+	shift_display(0x01);
 }
 
 void ledmatrix_shift_display_up(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x08);
+	shift_display(0x08);
 }
 
 void ledmatrix_shift_display_down(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x04);
+	shift_display(0x04);
 }
 
 void ledmatrix_clear(void) {
-	(void)spi_send_byte(CMD_CLEAR_SCREEN);
+	for(uint8_t panel = 0; panel < MATRIX_NUM_PANELS; panel++) {
+		select_panel(panel);
+		spi_queue_byte(CMD_CLEAR_SCREEN);
+		dirty_rows[panel] = 0;
+	}
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		set_matrix_column_to_colour(sent_frame[x], 0);
+		set_matrix_column_to_colour(pending_frame[x], 0);
+	}
+}
+
+void ledmatrix_set_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
+	if(x >= MATRIX_NUM_COLUMNS || y >= MATRIX_NUM_ROWS) {
+		// Position isn't valid - we ignore the request.
+		return;
+	}
+	pending_frame[x][y] = pixel;
+	dirty_rows[PANEL_AT(x, y)] |= (1<<(y & 0x07));
 }
 
+void ledmatrix_set_row(uint8_t y, MatrixRow row) {
+	if(y >= MATRIX_NUM_ROWS) {
+		// y value is too large - we ignore the request
+		return;
+	}
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		pending_frame[x][y] = row[x];
+	}
+	mark_row_dirty(y);
+}
+
+void ledmatrix_shift_row(uint8_t y, int8_t direction, PixelColour fill) {
+	if(y >= MATRIX_NUM_ROWS || (direction != 1 && direction != -1)) {
+		// Invalid row or direction - we ignore the request
+		return;
+	}
+	if(row_shift_supported) {
+		// Each panel shifts its own part of the row. The column shifted
+		// in to a panel is the one shifted out of the panel next to it
+		// (or the fill colour at the end of the row).
+		for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x += MATRIX_PANEL_COLUMNS) {
+			PixelColour panel_fill = fill;
+			if(direction == 1 && x > 0) {
+				panel_fill = sent_frame[x-1][y];
+			} else if(direction == -1 && x + MATRIX_PANEL_COLUMNS < MATRIX_NUM_COLUMNS) {
+				panel_fill = sent_frame[x + MATRIX_PANEL_COLUMNS][y];
+			}
+			select_panel(PANEL_AT(x, y));
+			spi_queue_byte(CMD_SHIFT_ROW);
+			spi_queue_byte(((direction == 1 ? 0x01 : 0x02)<<4) | (y & 0x07));
+			spi_queue_byte(panel_fill);
+		}
+		shift_row(sent_frame, 0, MATRIX_NUM_COLUMNS-1, y, direction, fill);
+		shift_row(pending_frame, 0, MATRIX_NUM_COLUMNS-1, y, direction, fill);
+		// Uncommitted changes may have moved into the next panel
+		if(MATRIX_NUM_PANELS > 1) {
+			mark_row_dirty(y);
+		}
+	} else {
+		// Shift our copy and send the whole row
+		shift_row(pending_frame, 0, MATRIX_NUM_COLUMNS-1, y, direction, fill);
+		send_row(y, pending_frame);
+	}
+}
+
+void ledmatrix_set_row_shift_supported(uint8_t supported) {
+	row_shift_supported = supported;
+}
+
+void ledmatrix_commit(void) {
+#if MATRIX_NUM_PANELS > 1
+	// Start with the panel that is already selected, so each frame needs
+	// at most one less panel switch (and queue flush - see select_panel())
+	uint8_t panel = selected_panel;
+	for(uint8_t i = 0; i < MATRIX_NUM_PANELS; i++) {
+		if(dirty_rows[panel]) {
+			commit_panel(panel);
+		}
+		if(++panel == MATRIX_NUM_PANELS) {
+			panel = 0;
+		}
+	}
+#else
+	if(dirty_rows[0]) {
+		commit_panel(0);
+	}
+#endif
+}
 void copy_matrix_column(MatrixColumn from, MatrixColumn to) {
 	for(uint8_t row = 0; row <MATRIX_NUM_ROWS; row++) {
 		to[row] = from[row];
@@ -114,3 +322,264 @@ void set_matrix_row_to_colour(MatrixRow matrix_row, PixelColour colour) {
 		matrix_row[column] = colour;
 	}
 }
+
+// Select the panel that the following commands are for. The commands
+// already queued for the panel that was selected must be sent first.
+static void select_panel(uint8_t panel) {
+#if MATRIX_NUM_PANELS > 1
+	if(panel == selected_panel) {
+		return;
+	}
+	spi_flush();
+	// Port D is shared with the seven segment display's digit select,
+	// which update_countdown_display() changes from the main loop, so
+	// only our pins are changed. Interrupts are off during the
+	// read-modify-write in case an interrupt handler is ever given a
+	// port D pin.
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	PORTD = (PORTD | PANEL_SELECT_PINS) & ~(1 << (LEDMATRIX_FIRST_SELECT_PIN + panel));
+	if(interrupts_enabled) {
+		sei();
+	}
+	selected_panel = panel;
+#else
+	(void)panel;
+#endif
+}
+
+// Send the given panel's part of the given frame using the update all
+// command
+static void send_panel(uint8_t panel, MatrixData data) {
+	uint8_t first_x = PANEL_FIRST_COLUMN(panel);
+	uint8_t first_y = PANEL_FIRST_ROW(panel);
+	select_panel(panel);
+	spi_queue_byte(CMD_UPDATE_ALL);
+	for(uint8_t y = first_y; y < first_y + MATRIX_PANEL_ROWS; y++) {
+		for(uint8_t x = first_x; x < first_x + MATRIX_PANEL_COLUMNS; x++) {
+			spi_queue_byte(data[x][y]);
+			pending_frame[x][y] = sent_frame[x][y] = data[x][y];
+		}
+	}
+	dirty_rows[panel] = 0;
+}
+
+// Mark row y as dirty in every panel it goes through
+static void mark_row_dirty(uint8_t y) {
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x += MATRIX_PANEL_COLUMNS) {
+		dirty_rows[PANEL_AT(x, y)] |= (1<<(y & 0x07));
+	}
+}
+
+// Send row y of the given frame using the update row command
+static void send_row(uint8_t y, MatrixData data) {
+	MatrixRow row;
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		row[x] = data[x][y];
+	}
+	ledmatrix_update_row(y, row);
+}
+
+// Shift the display (direction is the CMD_SHIFT_DISPLAY argument - see
+// shift_frame()). A single panel can do this itself. Panels can't shift
+// pixels across to the panel next to them, so with more than one panel we
+// shift our copy and send whatever has changed (including any changes
+// that hadn't been committed yet).
+static void shift_display(uint8_t direction) {
+#if MATRIX_NUM_PANELS > 1
+	shift_frame(pending_frame, direction);
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		mark_row_dirty(y);
+	}
+	ledmatrix_commit();
+#else
+	spi_queue_byte(CMD_SHIFT_DISPLAY);
+	spi_queue_byte(direction);
+	shift_frame(sent_frame, direction);
+	shift_frame(pending_frame, direction);
+#endif
+}
+
+// Send the dirty rows of one panel. We work out the cheapest way (fewest
+// bytes) of sending each dirty row: as pixel updates, as a row update, or
+// (if the LED matrix supports it) as a row shift plus pixel updates for
+// whatever the shift doesn't fix.
+static void commit_panel(uint8_t panel) {
+	uint8_t first_x = PANEL_FIRST_COLUMN(panel);
+	uint8_t first_y = PANEL_FIRST_ROW(panel);
+	uint8_t method[MATRIX_PANEL_ROWS];
+	uint8_t changed_pixels, row_bytes;
+	uint16_t total_bytes = 0;
+
+	for(uint8_t row = 0; row < MATRIX_PANEL_ROWS; row++) {
+		uint8_t y = first_y + row;
+		method[row] = SEND_NOTHING;
+		if(!(dirty_rows[panel] & (1<<row))) {
+			continue;
+		}
+		changed_pixels = 0;
+		for(uint8_t x = first_x; x < first_x + MATRIX_PANEL_COLUMNS; x++) {
+			if(pending_frame[x][y] != sent_frame[x][y]) {
+				changed_pixels++;
+			}
+		}
+		if(changed_pixels == 0) {
+			continue;
+		}
+		method[row] = SEND_PIXELS;
+		row_bytes = changed_pixels * UPDATE_PIXEL_BYTES;
+		if(row_bytes > UPDATE_ROW_BYTES) {
+			method[row] = SEND_ROW;
+			row_bytes = UPDATE_ROW_BYTES;
+		}
+		if(row_shift_supported && changed_pixels > 1) {
+			uint8_t shift_bytes = SHIFT_ROW_BYTES +
+					changes_after_row_shift(panel, y, 1) * UPDATE_PIXEL_BYTES;
+			if(shift_bytes < row_bytes) {
+				method[row] = SEND_SHIFT_RIGHT;
+				row_bytes = shift_bytes;
+			}
+			shift_bytes = SHIFT_ROW_BYTES +
+					changes_after_row_shift(panel, y, -1) * UPDATE_PIXEL_BYTES;
+			if(shift_bytes < row_bytes) {
+				method[row] = SEND_SHIFT_LEFT;
+				row_bytes = shift_bytes;
+			}
+		}
+		total_bytes += row_bytes;
+	}
+	dirty_rows[panel] = 0;
+
+	if(total_bytes >= UPDATE_ALL_BYTES) {
+		// Most of the panel has changed - send it all in one go
+		send_panel(panel, pending_frame);
+		return;
+	}
+
+	for(uint8_t row = 0; row < MATRIX_PANEL_ROWS; row++) {
+		uint8_t y = first_y + row;
+		switch(method[row]) {
+			case SEND_ROW:
+				send_panel_row(panel, y);
+				break;
+			case SEND_SHIFT_RIGHT:
+				send_row_shift(panel, y, 1);
+				send_changed_pixels(panel, y);
+				break;
+			case SEND_SHIFT_LEFT:
+				send_row_shift(panel, y, -1);
+				send_changed_pixels(panel, y);
+				break;
+			case SEND_PIXELS:
+				// Only a few pixels have changed - send just those
+				send_changed_pixels(panel, y);
+				break;
+		}
+	}
+}
+
+// Send the given panel's part of row y of pending_frame using the update
+// row command
+static void send_panel_row(uint8_t panel, uint8_t y) {
+	uint8_t first_x = PANEL_FIRST_COLUMN(panel);
+	select_panel(panel);
+	spi_queue_byte(CMD_UPDATE_ROW);
+	spi_queue_byte(y & 0x07);
+	for(uint8_t x = first_x; x < first_x + MATRIX_PANEL_COLUMNS; x++) {
+		spi_queue_byte(pending_frame[x][y]);
+		sent_frame[x][y] = pending_frame[x][y];
+	}
+}
+
+// Send update pixel commands for each pixel in the given panel's part of
+// row y that differs from what was last sent
+static void send_changed_pixels(uint8_t panel, uint8_t y) {
+	uint8_t first_x = PANEL_FIRST_COLUMN(panel);
+	for(uint8_t x = first_x; x < first_x + MATRIX_PANEL_COLUMNS; x++) {
+		if(pending_frame[x][y] != sent_frame[x][y]) {
+			ledmatrix_update_pixel(x, y, pending_frame[x][y]);
+		}
+	}
+}
+
+// Send a row shift command to the given panel for row y, in the given
+// direction (1 for right, -1 for left), that fills the column shifted in
+// with the pixel from pending_frame. Only sent_frame is changed -
+// pending_frame already holds what we want.
+static void send_row_shift(uint8_t panel, uint8_t y, int8_t direction) {
+	uint8_t first_x = PANEL_FIRST_COLUMN(panel);
+	uint8_t last_x = first_x + MATRIX_PANEL_COLUMNS - 1;
+	PixelColour fill = pending_frame[direction == 1 ? first_x : last_x][y];
+	select_panel(panel);
+	spi_queue_byte(CMD_SHIFT_ROW);
+	spi_queue_byte(((direction == 1 ? 0x01 : 0x02)<<4) | (y & 0x07));
+	spi_queue_byte(fill);
+	shift_row(sent_frame, first_x, last_x, y, direction, fill);
+}
+
+// Count the pixels in the given panel's part of row y of pending_frame
+// that would still differ from sent_frame if that part of sent_frame was
+// shifted in the given direction (1 for right, -1 for left). The column
+// shifted in is filled by the shift command so isn't counted.
+static uint8_t changes_after_row_shift(uint8_t panel, uint8_t y, int8_t direction) {
+	uint8_t first_x = PANEL_FIRST_COLUMN(panel);
+	uint8_t changes = 0;
+	for(uint8_t x = first_x + 1; x < first_x + MATRIX_PANEL_COLUMNS; x++) {
+		if(direction == 1) {
+			changes += (pending_frame[x][y] != sent_frame[x-1][y]);
+		} else {
+			changes += (pending_frame[x-1][y] != sent_frame[x][y]);
+		}
+	}
+	return changes;
+}
+
+// Shift columns first_x to last_x of row y of the given frame one column
+// in the given direction (1 for right, -1 for left) and put the fill
+// colour in the column shifted in.
+static void shift_row(MatrixData data, uint8_t first_x, uint8_t last_x, uint8_t y,
+		int8_t direction, PixelColour fill) {
+	if(direction == 1) {
+		for(uint8_t x = last_x; x > first_x; x--) {
+			data[x][y] = data[x-1][y];
+		}
+		data[first_x][y] = fill;
+	} else {
+		for(uint8_t x = first_x; x < last_x; x++) {
+			data[x][y] = data[x+1][y];
+		}
+		data[last_x][y] = fill;
+	}
+}
+
+// Apply a CMD_SHIFT_DISPLAY to our copy of a frame so that it matches
+// what the LED matrix does. direction is the command argument (0x01 right,
+// 0x02 left, 0x04 down, 0x08 up). Pixels shifted in are blank.
+static void shift_frame(MatrixData data, uint8_t direction) {
+	int8_t x, y;
+	if(direction == 0x01) {
+		for(x = MATRIX_NUM_COLUMNS-1; x > 0; x--) {
+			copy_matrix_column(data[x-1], data[x]);
+		}
+		set_matrix_column_to_colour(data[0], 0);
+	} else if(direction == 0x02) {
+		for(x = 0; x < MATRIX_NUM_COLUMNS-1; x++) {
+			copy_matrix_column(data[x+1], data[x]);
+		}
+		set_matrix_column_to_colour(data[MATRIX_NUM_COLUMNS-1], 0);
+	} else {
+		for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			if(direction == 0x08) {
+				for(y = MATRIX_NUM_ROWS-1; y > 0; y--) {
+					data[x][y] = data[x][y-1];
+				}
+				data[x][0] = 0;
+			} else {
+				for(y = 0; y < MATRIX_NUM_ROWS-1; y++) {
+					data[x][y] = data[x][y+1];
+				}
+				data[x][MATRIX_NUM_ROWS-1] = 0;
+			}
+		}
+	}
+}
@@ -11,10 +11,42 @@
 #include <stdint.h>
 #include "pixel_colour.h"
 
-// The matrix has 16 columns (x ranges from 0 to 15, left to right) and 
-// 8 rows (y ranges from 0 to 7, bottom to top)
-#define MATRIX_NUM_COLUMNS 16
-#define MATRIX_NUM_ROWS 8
+// Each LED matrix panel has 16 columns and 8 rows. The display can be
+// made of several panels, LEDMATRIX_PANELS_ACROSS wide and
+// LEDMATRIX_PANELS_DOWN high (1 x 1 unless defined otherwise - e.g. 1 x 2
+// for a 16 x 16 display). Panels are numbered across then up from the
+// bottom left - panel n has its slave select on pin
+// LEDMATRIX_FIRST_SELECT_PIN + n of port D (unless there is only one
+// panel, which always uses the SPI SS pin).
+// Switching panels waits (in the main loop) for everything already queued
+// for the last panel to be sent - at the rate limited speed of about 24
+// bytes/ms that can be several ms. ledmatrix_commit() switches to each
+// changed panel at most once, starting with the one already selected, but
+// a frame that changes every panel still waits for all but the last
+// panel's bytes. The immediate update functions switch panels as needed.
+// Two copies of the display are kept in RAM (see ledmatrix.c) - 256 bytes
+// per panel, which is 1 KB of the ATmega324A's 2 KB for a 2 x 2 display.
+// That doesn't leave enough for the rest of the game, so at most two panels
+// can be used unless LEDMATRIX_ALLOW_LARGE_DISPLAY is defined (e.g. for the
+// host simulation).
+#define MATRIX_PANEL_COLUMNS 16
+#define MATRIX_PANEL_ROWS 8
+#ifndef LEDMATRIX_PANELS_ACROSS
+#define LEDMATRIX_PANELS_ACROSS 1
+#endif
+#ifndef LEDMATRIX_PANELS_DOWN
+#define LEDMATRIX_PANELS_DOWN 1
+#endif
+#define MATRIX_NUM_PANELS (LEDMATRIX_PANELS_ACROSS * LEDMATRIX_PANELS_DOWN)
+#ifndef LEDMATRIX_FIRST_SELECT_PIN
+#define LEDMATRIX_FIRST_SELECT_PIN 4
+#endif
+
+// The whole display has MATRIX_NUM_COLUMNS columns (x ranges from 0 to
+// MATRIX_NUM_COLUMNS-1, left to right) and MATRIX_NUM_ROWS rows (y ranges
+// from 0 to MATRIX_NUM_ROWS-1, bottom to top)
+#define MATRIX_NUM_COLUMNS (MATRIX_PANEL_COLUMNS * LEDMATRIX_PANELS_ACROSS)
+#define MATRIX_NUM_ROWS (MATRIX_PANEL_ROWS * LEDMATRIX_PANELS_DOWN)
 
 // Data types which can be used to store display information
 typedef PixelColour MatrixData[MATRIX_NUM_COLUMNS][MATRIX_NUM_ROWS];
@@ -23,9 +55,18 @@ typedef PixelColour MatrixColumn[MATRIX_NUM_ROWS];
 
 // Setup SPI communication with the LED matrix.
 // This function must be called before the LED matrix functions
-// below are used.
+// below are used. The fast SPI speed is used unless LEDMATRIX_SAFE_SPI
+// is defined.
 void ledmatrix_setup(void);
 
+// Fall back to the slow (clock/128) SPI speed. This should be used if the
+// display shows corruption at the fast speed. Call ledmatrix_repaint()
+// afterwards to resend the whole display.
+void ledmatrix_use_safe_spi_speed(void);
+
+// Resend the whole display (including any changes not yet committed).
+void ledmatrix_repaint(void);
+
 // Functions to update the display
 // For those functions which take an x or a y value, the value must be valid
 // or the request will be ignored. (i.e. x must be < MATRIX_NUM_COLUMNS
@@ -40,6 +81,32 @@ void ledmatrix_shift_display_up(void);
 void ledmatrix_shift_display_down(void);
 void ledmatrix_clear(void);
 
+// Shift row y one column right (direction 1) or left (direction -1) and
+// fill the column shifted in with the given colour. This takes 3 bytes
+// if the LED matrix firmware supports shifting a single row, otherwise the
+// whole row is sent.
+void ledmatrix_shift_row(uint8_t y, int8_t direction, PixelColour fill);
+
+// Tell this module whether the LED matrix firmware supports shifting a
+// single row. (The LED matrix can't be asked, so this defaults to not
+// supported unless LEDMATRIX_HAS_ROW_SHIFT is defined.) When supported,
+// ledmatrix_commit() will send a row that has scrolled by one column
+// as a row shift plus pixel updates for anything else that changed.
+void ledmatrix_set_row_shift_supported(uint8_t supported);
+
+// Functions to update the display through a shadow copy kept in RAM.
+// ledmatrix_set_pixel() and ledmatrix_set_row() only change the shadow copy.
+// Nothing is sent to the LED matrix until ledmatrix_commit() is called - this
+// compares the shadow copy with what was last sent and sends the cheapest
+// commands (pixel, row or whole display updates) that bring the display up
+// to date. Changes are tracked for each panel separately, so a panel that
+// hasn't changed costs nothing. The immediate update functions above
+// also keep the shadow copy up to date so the two sets of functions can
+// be mixed.
+void ledmatrix_set_pixel(uint8_t x, uint8_t y, PixelColour pixel);
+void ledmatrix_set_row(uint8_t y, MatrixRow row);
+void ledmatrix_commit(void);
+
 // Functions to operate on rows and columns
 void copy_matrix_column(MatrixColumn from, MatrixColumn to);
 void copy_matrix_row(MatrixRow from, MatrixRow to);
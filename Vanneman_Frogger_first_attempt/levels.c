@@ -0,0 +1,491 @@
+/*
+ * levels.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include <avr/pgmspace.h>
+#include "levels.h"
+
+// Each time round the pack every lane period is shortened by
+// CYCLE_SPEED_UP ms, down to MIN_LANE_PERIOD.
+#define CYCLE_SPEED_UP 300
+#define MIN_LANE_PERIOD 100
+
+// Generated levels get harder up to level MAX_DIFFICULTY + 1 and then stay
+// the same. At difficulty d lane periods are the level 1 periods scaled by
+// DIFFICULTY_SCALE / (DIFFICULTY_SCALE + d).
+#define MAX_DIFFICULTY 24
+#define DIFFICULTY_SCALE 8
+
+// Limits on generated runs (in columns) so a level can always be done. The
+// frog can always fit between vehicles, and a frog waiting on the halfway
+// row (or on a log) never waits more than a few scrolls for a log.
+#define MIN_TRAFFIC_GAP 2
+#define MIN_LOG_LENGTH 2
+#define MAX_WATER_GAP 3
+
+// Generated patterns don't repeat, but lane positions still wrap around
+// after this many columns
+#define GENERATED_PATTERN_LENGTH 0x7FFF
+
+// Patterns are stored as runs of empty or filled (vehicle or log) columns.
+// Each byte is one run - bit 7 is 1 for filled, 0 for empty, and the
+// other 7 bits are the number of columns (1 to 127). A pattern can have up
+// to 255 runs.
+#define EMPTY(columns) (columns)
+#define FILLED(columns) (0x80 | (columns))
+#define RUN_FILLED(run) ((run) >> 7)
+#define RUN_LENGTH(run) ((run) & 0x7F)
+
+typedef struct {
+	const uint8_t* runs;	// in flash
+	uint8_t num_runs;
+} PackedPattern;
+#define PATTERN(runs) { runs, sizeof(runs) }
+
+typedef struct {
+	LevelSettings settings;
+	PackedPattern patterns[NUM_PATTERNS];
+} PackedLevel;
+
+// Traffic and log patterns. Column 0 of each pattern is on the left.
+static const uint8_t traffic_1[] PROGMEM = {
+	EMPTY(3), FILLED(2), EMPTY(2), FILLED(2), EMPTY(5), FILLED(2), EMPTY(3), FILLED(2),
+	EMPTY(3), FILLED(2), EMPTY(4), FILLED(2), EMPTY(3), FILLED(2), EMPTY(2), FILLED(2),
+	EMPTY(5), FILLED(2), EMPTY(3), FILLED(2), EMPTY(3), FILLED(2), EMPTY(4), FILLED(2)
+};
+static const uint8_t traffic_2[] PROGMEM = {
+	EMPTY(2), FILLED(3), EMPTY(4), FILLED(3), EMPTY(4), FILLED(3), EMPTY(3), FILLED(3),
+	EMPTY(4), FILLED(3), EMPTY(4), FILLED(3), EMPTY(5), FILLED(3), EMPTY(4), FILLED(3),
+	EMPTY(5), FILLED(3), EMPTY(2)
+};
+static const uint8_t traffic_3[] PROGMEM = {
+	FILLED(3), EMPTY(3), FILLED(4), EMPTY(4), FILLED(5), EMPTY(5), FILLED(4), EMPTY(4),
+	FILLED(4), EMPTY(4), FILLED(4), EMPTY(4), FILLED(4), EMPTY(4), FILLED(4), EMPTY(4)
+};
+static const uint8_t logs_1[] PROGMEM = {
+	EMPTY(3), FILLED(5), EMPTY(3), FILLED(4), EMPTY(3), FILLED(3), EMPTY(2), FILLED(2),
+	EMPTY(3), FILLED(4)
+};
+static const uint8_t logs_2[] PROGMEM = {
+	EMPTY(2), FILLED(3), EMPTY(2), FILLED(2), EMPTY(1), FILLED(3), EMPTY(4), FILLED(2),
+	EMPTY(1), FILLED(4), EMPTY(1), FILLED(2), EMPTY(2), FILLED(3)
+};
+
+// Longer patterns (over 100 columns) so the traffic doesn't visibly repeat
+static const uint8_t long_traffic_1[] PROGMEM = {
+	EMPTY(3), FILLED(2), EMPTY(2), FILLED(2), EMPTY(5), FILLED(2), EMPTY(3), FILLED(2),
+	EMPTY(6), FILLED(3), EMPTY(2), FILLED(2), EMPTY(4), FILLED(2), EMPTY(3), FILLED(2),
+	EMPTY(2), FILLED(2), EMPTY(7), FILLED(2), EMPTY(3), FILLED(3), EMPTY(3), FILLED(2),
+	EMPTY(4), FILLED(2), EMPTY(2), FILLED(2), EMPTY(5), FILLED(2), EMPTY(3), FILLED(3),
+	EMPTY(4), FILLED(2), EMPTY(6), FILLED(2), EMPTY(2), FILLED(2), EMPTY(3), FILLED(2)
+};
+static const uint8_t long_traffic_2[] PROGMEM = {
+	EMPTY(2), FILLED(3), EMPTY(4), FILLED(3), EMPTY(6), FILLED(3), EMPTY(3), FILLED(4),
+	EMPTY(4), FILLED(3), EMPTY(5), FILLED(3), EMPTY(3), FILLED(3), EMPTY(7), FILLED(3),
+	EMPTY(4), FILLED(4), EMPTY(3), FILLED(3), EMPTY(5), FILLED(3), EMPTY(4), FILLED(3),
+	EMPTY(6), FILLED(3), EMPTY(2)
+};
+static const uint8_t long_traffic_3[] PROGMEM = {
+	FILLED(3), EMPTY(3), FILLED(4), EMPTY(4), FILLED(5), EMPTY(5), FILLED(4), EMPTY(3),
+	FILLED(6), EMPTY(4), FILLED(4), EMPTY(5), FILLED(3), EMPTY(4), FILLED(5), EMPTY(3),
+	FILLED(4), EMPTY(6), FILLED(4), EMPTY(4), FILLED(3), EMPTY(4), FILLED(5), EMPTY(5)
+};
+
+#define STANDARD_PATTERNS { PATTERN(traffic_1), PATTERN(traffic_2), \
+		PATTERN(traffic_3), PATTERN(logs_1), PATTERN(logs_2) }
+#define LONG_PATTERNS { PATTERN(long_traffic_1), PATTERN(long_traffic_2), \
+		PATTERN(long_traffic_3), PATTERN(logs_1), PATTERN(logs_2) }
+
+// Riverbank patterns with 4, 5 and 6 holes. Note that the least 
+// significant bit (RHS) corresponds to column 0 on the display (LHS).
+#define FOUR_HOLES	0b1101110111011101
+#define FIVE_HOLES	0b1101010111011101
+#define SIX_HOLES	0b1101010101011101
+
+// Colour themes, indexed by the PALETTE_... entries in levels.h
+#define PALETTE_RED_YELLOW_RED		0
+#define PALETTE_YELLOW_RED_YELLOW	1
+#define PALETTE_YELLOW_RED_RED		2
+static const PixelColour palettes[][PALETTE_SIZE] PROGMEM = {
+	// Edges, road, water, logs, then the vehicles in each traffic lane
+	{ COLOUR_LIGHT_GREEN, COLOUR_BLACK, COLOUR_BLACK, COLOUR_ORANGE,
+			COLOUR_RED, COLOUR_YELLOW, COLOUR_RED },
+	{ COLOUR_LIGHT_GREEN, COLOUR_BLACK, COLOUR_BLACK, COLOUR_ORANGE,
+			COLOUR_YELLOW, COLOUR_RED, COLOUR_YELLOW },
+	{ COLOUR_LIGHT_GREEN, COLOUR_BLACK, COLOUR_BLACK, COLOUR_ORANGE,
+			COLOUR_YELLOW, COLOUR_RED, COLOUR_RED }
+};
+
+// Traffic lanes 1 and 3 move to the right and lane 2 to the left. River
+// channel 1 moves to the left and 2 to the right. Each level is 50ms
+// faster than the one before, and from level 4 the traffic doesn't repeat
+// as often.
+static const PackedLevel level_pack[] PROGMEM = {
+	{	// Level 1
+		{	{ { 1, 1000, 0 }, { -1, 1300, 0 }, { 1, 750, 0 } },
+			{ { -1, 850, 0 }, { 1, 1200, 0 } },
+			PALETTE_RED_YELLOW_RED, FOUR_HOLES },
+		STANDARD_PATTERNS
+	},
+	{	// Level 2
+		{	{ { 1, 950, 1 }, { -1, 1250, 1 }, { 1, 700, 1 } },
+			{ { -1, 800, 0 }, { 1, 1150, 0 } },
+			PALETTE_YELLOW_RED_YELLOW, FIVE_HOLES },
+		STANDARD_PATTERNS
+	},
+	{	// Level 3
+		{	{ { 1, 900, 0 }, { -1, 1200, 0 }, { 1, 650, 0 } },
+			{ { -1, 750, 1 }, { 1, 1100, 1 } },
+			PALETTE_YELLOW_RED_RED, SIX_HOLES },
+		STANDARD_PATTERNS
+	},
+	{	// Level 4
+		{	{ { 1, 850, 1 }, { -1, 1150, 1 }, { 1, 600, 1 } },
+			{ { -1, 700, 0 }, { 1, 1050, 0 } },
+			PALETTE_YELLOW_RED_YELLOW, FIVE_HOLES },
+		LONG_PATTERNS
+	},
+	{	// Level 5
+		{	{ { 1, 800, 0 }, { -1, 1100, 0 }, { 1, 550, 0 } },
+			{ { -1, 650, 0 }, { 1, 1000, 0 } },
+			PALETTE_RED_YELLOW_RED, FOUR_HOLES },
+		LONG_PATTERNS
+	},
+	{	// Level 6
+		{	{ { 1, 750, 1 }, { -1, 1050, 1 }, { 1, 500, 1 } },
+			{ { -1, 600, 0 }, { 1, 950, 0 } },
+			PALETTE_YELLOW_RED_YELLOW, FIVE_HOLES },
+		LONG_PATTERNS
+	}
+};
+#define NUM_PACKED_LEVELS (sizeof(level_pack) / sizeof(level_pack[0]))
+
+static LevelSettings settings;
+static const PackedLevel* packed_level = &level_pack[0];
+
+// Decoder for each pattern. The window is tracked by a cursor (run number
+// and column within the run) at each end, so scrolling by one column only
+// has to step each cursor by one column.
+typedef struct {
+	PackedPattern pattern;
+	uint16_t length;
+	uint8_t left_run, left_offset;		// display column 0
+	uint8_t right_run, right_offset;	// display column FIELD_COLUMNS-1
+} PatternDecoder;
+static PatternDecoder decoders[NUM_PATTERNS];
+
+// Generator for each pattern when the levels are generated. The runs
+// alternate between empty and filled, with random lengths between the
+// limits for the level. Columns are generated in the order they come on
+// to the display.
+typedef struct {
+	uint16_t random;		// xorshift state (never 0)
+	uint8_t filled;			// 1 if the current run is vehicles or logs
+	uint8_t columns_left;	// in the current run
+	uint8_t min_filled, max_filled;
+	uint8_t min_empty, max_empty;
+} PatternGenerator;
+static PatternGenerator generators[NUM_PATTERNS];
+static uint16_t generator_seed;	// 0 if we are using the pack
+static uint32_t loaded_level;
+
+static void speed_up_lane(LaneSettings* lane, uint16_t speed_up);
+static void set_up_generators(uint32_t level);
+static uint16_t difficulty_period(uint16_t period, uint8_t difficulty);
+static int8_t pattern_direction(uint8_t pattern);
+static FieldMask generated_window(uint8_t pattern, uint16_t position);
+static uint8_t generate_column(PatternGenerator* generator);
+static uint8_t random_between(PatternGenerator* generator, uint8_t low, uint8_t high);
+static uint8_t get_run(const PatternDecoder* decoder, uint8_t run);
+static void step_forward(const PatternDecoder* decoder, uint8_t* run, uint8_t* offset);
+static void step_back(const PatternDecoder* decoder, uint8_t* run, uint8_t* offset);
+
+void load_level(uint32_t level) {
+	uint32_t cycle = (level - 1) / NUM_PACKED_LEVELS;
+	uint16_t speed_up;
+	uint8_t i, run;
+	
+	packed_level = &level_pack[(level - 1) % NUM_PACKED_LEVELS];
+	memcpy_P(&settings, &packed_level->settings, sizeof(settings));
+	
+	// Later times round the pack are faster
+	speed_up = (cycle > 0xFFFF / CYCLE_SPEED_UP) ? 0xFFFF : cycle * CYCLE_SPEED_UP;
+	for(i = 0; i < NUM_TRAFFIC_LANES; i++) {
+		speed_up_lane(&settings.lanes[i], speed_up);
+	}
+	for(i = 0; i < NUM_RIVER_CHANNELS; i++) {
+		speed_up_lane(&settings.channels[i], speed_up);
+	}
+	
+	// Get ready to decode the patterns
+	for(i = 0; i < NUM_PATTERNS; i++) {
+		PatternDecoder* decoder = &decoders[i];
+		memcpy_P(&decoder->pattern, &packed_level->patterns[i], sizeof(PackedPattern));
+		decoder->length = 0;
+		for(run = 0; run < decoder->pattern.num_runs; run++) {
+			decoder->length += RUN_LENGTH(get_run(decoder, run));
+		}
+	}
+	
+	loaded_level = level;
+	if(generator_seed) {
+		set_up_generators(level);
+	}
+}
+
+void set_level_generator(uint16_t seed) {
+	generator_seed = seed;
+}
+
+const LevelSettings* current_level(void) {
+	return &settings;
+}
+
+PixelColour palette_colour(uint8_t entry) {
+	return pgm_read_byte(&palettes[settings.palette][entry]);
+}
+
+uint16_t pattern_length(uint8_t pattern) {
+	return decoders[pattern].length;
+}
+
+FieldMask pattern_window(uint8_t pattern, uint16_t position) {
+	PatternDecoder* decoder = &decoders[pattern];
+	FieldMask window = 0;
+	uint8_t run = 0;
+	uint8_t offset;
+	
+	if(generator_seed) {
+		return generated_window(pattern, position);
+	}
+	
+	// Find the run containing the position
+	while(position >= RUN_LENGTH(get_run(decoder, run))) {
+		position -= RUN_LENGTH(get_run(decoder, run));
+		run++;
+	}
+	offset = position;
+	decoder->left_run = run;
+	decoder->left_offset = offset;
+	
+	// Decode the visible columns. The right hand cursor is left at
+	// the last of them.
+	for(uint8_t column = 0; ; column++) {
+		if(RUN_FILLED(get_run(decoder, run))) {
+			window |= ((FieldMask)1 << column);
+		}
+		if(column == FIELD_COLUMNS - 1) {
+			break;
+		}
+		step_forward(decoder, &run, &offset);
+	}
+	decoder->right_run = run;
+	decoder->right_offset = offset;
+	return window;
+}
+
+uint8_t pattern_scroll(uint8_t pattern, int8_t direction) {
+	PatternDecoder* decoder = &decoders[pattern];
+	if(generator_seed) {
+		return direction ? generate_column(&generators[pattern]) : 0;
+	}
+	if(direction > 0) {
+		step_back(decoder, &decoder->left_run, &decoder->left_offset);
+		step_back(decoder, &decoder->right_run, &decoder->right_offset);
+		return RUN_FILLED(get_run(decoder, decoder->left_run));
+	} else if(direction < 0) {
+		step_forward(decoder, &decoder->left_run, &decoder->left_offset);
+		step_forward(decoder, &decoder->right_run, &decoder->right_offset);
+		return RUN_FILLED(get_run(decoder, decoder->right_run));
+	}
+	return 0;
+}
+
+uint32_t pattern_lookahead(uint8_t pattern, int8_t direction, uint8_t count) {
+	const PatternDecoder* decoder = &decoders[pattern];
+	PatternGenerator generator;
+	uint32_t columns = 0;
+	uint8_t run, offset;
+	
+	if(direction == 0) {
+		return 0;
+	}
+	if(generator_seed) {
+		// Run a copy of the generator
+		generator = generators[pattern];
+		for(uint8_t i = 0; i < count; i++) {
+			columns |= (uint32_t)generate_column(&generator) << i;
+		}
+		return columns;
+	}
+	// Step a copy of the cursor at the edge the columns come on at
+	if(direction > 0) {
+		run = decoder->left_run;
+		offset = decoder->left_offset;
+	} else {
+		run = decoder->right_run;
+		offset = decoder->right_offset;
+	}
+	for(uint8_t i = 0; i < count; i++) {
+		if(direction > 0) {
+			step_back(decoder, &run, &offset);
+		} else {
+			step_forward(decoder, &run, &offset);
+		}
+		columns |= (uint32_t)RUN_FILLED(get_run(decoder, run)) << i;
+	}
+	return columns;
+}
+
+// Shorten the period of a lane by speed_up ms (but not below
+// MIN_LANE_PERIOD)
+static void speed_up_lane(LaneSettings* lane, uint16_t speed_up) {
+	if(lane->period < speed_up + (uint32_t)MIN_LANE_PERIOD) {
+		lane->period = MIN_LANE_PERIOD;
+	} else {
+		lane->period -= speed_up;
+	}
+}
+
+// Work out the lane speeds and run limits for a generated level
+static void set_up_generators(uint32_t level) {
+	uint8_t difficulty = (level > MAX_DIFFICULTY) ? MAX_DIFFICULTY : level - 1;
+	uint8_t i;
+	
+	// Speeds come from the difficulty curve rather than the pack
+	for(i = 0; i < NUM_TRAFFIC_LANES; i++) {
+		settings.lanes[i].period = difficulty_period(
+				pgm_read_word(&level_pack[0].settings.lanes[i].period), difficulty);
+	}
+	for(i = 0; i < NUM_RIVER_CHANNELS; i++) {
+		settings.channels[i].period = difficulty_period(
+				pgm_read_word(&level_pack[0].settings.channels[i].period), difficulty);
+	}
+	
+	// Vehicles get longer and the gaps between them shorter. Logs get
+	// shorter and the water between them wider.
+	for(i = 0; i < NUM_PATTERNS; i++) {
+		PatternGenerator* generator = &generators[i];
+		decoders[i].length = GENERATED_PATTERN_LENGTH;
+		if(i < NUM_TRAFFIC_LANES) {
+			generator->min_filled = 2;
+			generator->max_filled = 3 + difficulty / 8;
+			generator->min_empty = MIN_TRAFFIC_GAP;
+			generator->max_empty = (difficulty / 4 > 7 - (MIN_TRAFFIC_GAP + 1)) ?
+					MIN_TRAFFIC_GAP + 1 : 7 - difficulty / 4;
+		} else {
+			generator->min_filled = MIN_LOG_LENGTH;
+			generator->max_filled = (difficulty / 6 > 6 - MIN_LOG_LENGTH) ?
+					MIN_LOG_LENGTH : 6 - difficulty / 6;
+			generator->min_empty = 1;
+			generator->max_empty = (difficulty / 8 > MAX_WATER_GAP - 1) ?
+					MAX_WATER_GAP : 1 + difficulty / 8;
+		}
+	}
+}
+
+// Scale a level 1 lane period for the given difficulty
+static uint16_t difficulty_period(uint16_t period, uint8_t difficulty) {
+	period = (uint32_t)period * DIFFICULTY_SCALE / (DIFFICULTY_SCALE + difficulty);
+	return (period < MIN_LANE_PERIOD) ? MIN_LANE_PERIOD : period;
+}
+
+// Return the direction the given pattern scrolls in
+static int8_t pattern_direction(uint8_t pattern) {
+	if(pattern < NUM_TRAFFIC_LANES) {
+		return settings.lanes[pattern].direction;
+	}
+	return settings.channels[pattern - NUM_TRAFFIC_LANES].direction;
+}
+
+// Start generating a pattern from the beginning (so every life on a level
+// sees the same lanes), skip position columns and then return the window.
+// The window is filled in the order the columns would have scrolled on to
+// the display so the runs carry on smoothly when it starts scrolling.
+static FieldMask generated_window(uint8_t pattern, uint16_t position) {
+	PatternGenerator* generator = &generators[pattern];
+	FieldMask window = 0;
+	
+	generator->random = generator_seed ^ (uint16_t)(loaded_level * 0x9E37) ^ 
+			((pattern + 1) * 0x3C6F);
+	if(generator->random == 0) {
+		generator->random = 1;
+	}
+	// Start with a gap (the next run is empty)
+	generator->filled = 1;
+	generator->columns_left = 0;
+	
+	while(position > 0) {
+		generate_column(generator);
+		position--;
+	}
+	for(uint8_t column = 0; column < FIELD_COLUMNS; column++) {
+		if(pattern_direction(pattern) > 0) {
+			window = (window << 1) | generate_column(generator);
+		} else {
+			window = (window >> 1) | 
+					((FieldMask)generate_column(generator) << (FIELD_COLUMNS - 1));
+		}
+	}
+	return window;
+}
+
+// Return the next column of a generated pattern - 1 for a vehicle or log
+static uint8_t generate_column(PatternGenerator* generator) {
+	if(generator->columns_left == 0) {
+		generator->filled = !generator->filled;
+		if(generator->filled) {
+			generator->columns_left = random_between(generator,
+					generator->min_filled, generator->max_filled);
+		} else {
+			generator->columns_left = random_between(generator,
+					generator->min_empty, generator->max_empty);
+		}
+	}
+	generator->columns_left--;
+	return generator->filled;
+}
+
+// Return a random number from low to high (inclusive), using a 16 bit
+// xorshift generator
+static uint8_t random_between(PatternGenerator* generator, uint8_t low, uint8_t high) {
+	uint16_t x = generator->random;
+	x ^= x << 7;
+	x ^= x >> 9;
+	x ^= x << 8;
+	generator->random = x;
+	return low + x % (high - low + 1);
+}
+
+// Return the given run of a pattern (read from flash)
+static uint8_t get_run(const PatternDecoder* decoder, uint8_t run) {
+	return pgm_read_byte(&decoder->pattern.runs[run]);
+}
+
+// Move a cursor one column forward (to the right in the pattern), 
+// wrapping around at the end of the pattern
+static void step_forward(const PatternDecoder* decoder, uint8_t* run, uint8_t* offset) {
+	(*offset)++;
+	if(*offset >= RUN_LENGTH(get_run(decoder, *run))) {
+		*offset = 0;
+		(*run)++;
+		if(*run >= decoder->pattern.num_runs) {
+			*run = 0;
+		}
+	}
+}
+
+// Move a cursor one column back, wrapping around at the start of the pattern
+static void step_back(const PatternDecoder* decoder, uint8_t* run, uint8_t* offset) {
+	if(*offset > 0) {
+		(*offset)--;
+	} else {
+		if(*run == 0) {
+			*run = decoder->pattern.num_runs;
+		}
+		(*run)--;
+		*offset = RUN_LENGTH(get_run(decoder, *run)) - 1;
+	}
+}
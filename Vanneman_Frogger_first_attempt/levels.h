@@ -0,0 +1,99 @@
+/*
+ * levels.h
+ *
+ * Author: Becca Vanneman
+ *
+ * The level pack - what changes from level to level (lane patterns,
+ * directions and speeds, colours, where each lane starts and the
+ * riverbank holes). The pack is stored in flash. When a level is loaded its
+ * settings are copied into RAM but the lane and log patterns stay in flash
+ * and are decoded a column at a time as the lanes scroll.
+ * Levels after the last one in the pack go round the pack again, with
+ * every lane faster each time round.
+ * Alternatively the lanes can be generated as they scroll, from a seed -
+ * see set_level_generator().
+ */
+
+#ifndef LEVELS_H_
+#define LEVELS_H_
+
+#include <stdint.h>
+#include "pixel_colour.h"
+#include "field.h"
+
+#define NUM_TRAFFIC_LANES 3
+#define NUM_RIVER_CHANNELS 2
+
+// Patterns are numbered with the traffic lanes first, then the river
+// channels. A pattern is a sequence of columns (vehicle or not, log or
+// not) of any length - looped continuously as the lane scrolls.
+#define NUM_PATTERNS (NUM_TRAFFIC_LANES + NUM_RIVER_CHANNELS)
+#define LANE_PATTERN(lane) (lane)
+#define LOG_PATTERN(channel) (NUM_TRAFFIC_LANES + (channel))
+
+// The colours of the field come from a palette - a table of colours
+// indexed by these entries. The palettes are kept in flash and each level
+// picks one by number, so a new colour theme only takes flash.
+#define PALETTE_EDGES			0	// riverbank and roadsides
+#define PALETTE_ROAD			1
+#define PALETTE_WATER			2	// and empty holes in the riverbank
+#define PALETTE_LOGS			3
+#define PALETTE_VEHICLES(lane)	(4 + (lane))
+#define PALETTE_SIZE			(4 + NUM_TRAFFIC_LANES)
+
+typedef struct {
+	int8_t direction;	// 1 for right, -1 for left
+	uint16_t period;	// ms between each scroll
+	uint8_t start;		// position (pattern column shown in column 0) at the start of a life
+} LaneSettings;
+
+typedef struct {
+	LaneSettings lanes[NUM_TRAFFIC_LANES];
+	LaneSettings channels[NUM_RIVER_CHANNELS];
+	uint8_t palette;	// number of the palette with the level's colours
+	uint16_t riverbank;	// 1 for riverbank edge, 0 for a hole (bit n is column n,
+						// repeated across fields wider than 16 columns)
+} LevelSettings;
+
+// Load the given level (1 or more) from the pack.
+void load_level(uint32_t level);
+
+// Generate the traffic and logs from the given seed instead of using the
+// patterns in the pack (0 goes back to the pack). Takes effect from the
+// next load_level(). Generated lanes go on for ever without repeating and
+// the same seed always gives the same lanes for a level. Lanes get faster
+// and the traffic denser with each level, but there is always a gap of at
+// least 2 columns between vehicles, and a log never takes more than a few
+// scrolls to reach any column of the river. Directions, colours and
+// riverbanks still come from the pack.
+void set_level_generator(uint16_t seed);
+
+// Return the settings for the level last loaded.
+const LevelSettings* current_level(void);
+
+// Return the colour for a palette entry (PALETTE_...) in the level last
+// loaded. This is read from flash each time.
+PixelColour palette_colour(uint8_t entry);
+
+// Return the number of columns in a pattern of the level last loaded.
+uint16_t pattern_length(uint8_t pattern);
+
+// The visible window of a pattern is the FIELD_COLUMNS columns from the position
+// shown in column 0 of the display. pattern_window() starts decoding the
+// window at the given position (0 to pattern_length()-1) and returns it
+// (bit n is 1 if there is a vehicle or log in display column n).
+FieldMask pattern_window(uint8_t pattern, uint16_t position);
+
+// Move the window one column in the given direction (1 for right - the
+// position goes down by one - or -1 for left) and return the bit for the
+// column that has come on to the display (column 0 when moving right,
+// column FIELD_COLUMNS-1 when moving left). pattern_window() must have been called
+// since the level was loaded.
+uint8_t pattern_scroll(uint8_t pattern, int8_t direction);
+
+// Return what the next count (up to 32) calls of pattern_scroll() in the
+// given direction would return - bit k is the bit from the (k+1)th call -
+// without scrolling the pattern.
+uint32_t pattern_lookahead(uint8_t pattern, int8_t direction, uint8_t count);
+
+#endif /* LEVELS_H_ */
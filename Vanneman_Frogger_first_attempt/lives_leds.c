@@ -0,0 +1,22 @@
+/*
+ * lives_leds.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include <avr/io.h>
+#include "lives_leds.h"
+
+#define LIVES_LED_PINS ((1<<DDRA3) | (1<<DDRA2) | (1<<DDRA1) | (1<<DDRA0))
+
+void init_lives_leds(void) {
+	DDRA |= LIVES_LED_PINS;
+	PORTA &= ~LIVES_LED_PINS;
+}
+
+void show_lives(uint8_t lives) {
+	if(lives > MAX_LIVES_SHOWN) {
+		lives = MAX_LIVES_SHOWN;
+	}
+	PORTA = (PORTA & ~LIVES_LED_PINS) | ((1<<lives) - 1);
+}
@@ -0,0 +1,25 @@
+/*
+ * lives_leds.h
+ *
+ * Author: Becca Vanneman
+ *
+ * The LEDs on pins A0 to A3 show the number of lives left - one LED for
+ * each life, from A0 up. The game only talks to the LEDs through these
+ * functions so it doesn't depend on which port they are on.
+ */
+
+#ifndef LIVES_LEDS_H_
+#define LIVES_LEDS_H_
+
+#include <stdint.h>
+
+#define MAX_LIVES_SHOWN 4
+
+// Make the LED pins outputs (all LEDs off)
+void init_lives_leds(void);
+
+// Show the given number of lives (more than MAX_LIVES_SHOWN shows
+// MAX_LIVES_SHOWN)
+void show_lives(uint8_t lives);
+
+#endif /* LIVES_LEDS_H_ */
@@ -0,0 +1,116 @@
+/*
+ * profiler.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include "profiler.h"
+
+#ifdef PROFILING
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "serialio.h"
+
+// Longest line printed by profiler_dump()
+#define DUMP_LINE_LENGTH 40
+
+typedef struct {
+	uint16_t count;
+	uint16_t min;
+	uint16_t max;
+	uint32_t total;
+} SectionStats;
+
+static SectionStats stats[PROFILE_NUM_SECTIONS];
+
+static const char main_loop_name[] PROGMEM = "main loop";
+static const char scroll_lane_name[] PROGMEM = "scroll lane";
+static const char scroll_river_name[] PROGMEM = "scroll river";
+static const char redraw_river_name[] PROGMEM = "redraw river";
+static const char timer0_isr_name[] PROGMEM = "timer0 ISR";
+static const char spi_stall_name[] PROGMEM = "SPI stall";
+static PGM_P const section_names[PROFILE_NUM_SECTIONS] = {
+	main_loop_name, scroll_lane_name, scroll_river_name, redraw_river_name,
+	timer0_isr_name, spi_stall_name
+};
+
+static void clear_stats(void);
+
+void init_profiler(void) {
+	// Normal mode (count up to 0xFFFF and wrap), clock divided by 8,
+	// no interrupts
+	TCCR1A = 0;
+	TCNT1 = 0;
+	TCCR1B = (1<<CS11);
+	clear_stats();
+}
+
+uint16_t profiler_time(void) {
+	// Reading the 16 bit count uses a temporary register which an
+	// interrupt handler reading the count could overwrite, so interrupts
+	// are turned off while we read it.
+	uint16_t time;
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	time = TCNT1;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return time;
+}
+
+void profiler_record(uint8_t section, uint16_t start_time) {
+	uint16_t duration = profiler_time() - start_time;
+	SectionStats* s = &stats[section];
+	
+	if(s->count == 0xFFFF) {
+		// Full - don't let the count wrap and spoil the average
+		return;
+	}
+	if(s->count == 0 || duration < s->min) {
+		s->min = duration;
+	}
+	if(duration > s->max) {
+		s->max = duration;
+	}
+	s->total += duration;
+	s->count++;
+}
+
+void profiler_dump(void) {
+	SectionStats s;
+	
+	serial_wait_for_output_space(DUMP_LINE_LENGTH);
+	printf_P(PSTR("\n%-12s %5s %5s %5s %5s\n"), "section (us)", "count",
+			"min", "avg", "max");
+	for(uint8_t i = 0; i < PROFILE_NUM_SECTIONS; i++) {
+		// Take a copy with interrupts off (the timer 0 section is updated
+		// by its interrupt handler)
+		cli();
+		s = stats[i];
+		sei();
+		serial_wait_for_output_space(DUMP_LINE_LENGTH);
+		printf_P(PSTR("%-12S %5u %5u %5lu %5u\n"), section_names[i], s.count,
+				s.min, s.count ? s.total / s.count : 0, s.max);
+	}
+	clear_stats();
+}
+
+static void clear_stats(void) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	for(uint8_t i = 0; i < PROFILE_NUM_SECTIONS; i++) {
+		stats[i].count = 0;
+		stats[i].min = 0;
+		stats[i].max = 0;
+		stats[i].total = 0;
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+#endif /* PROFILING */
@@ -0,0 +1,61 @@
+/*
+ * profiler.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Measures how long sections of code take, using timer 1 as a free running
+ * counter (clock/8, so one count per microsecond at 8MHz). Put
+ * PROFILE_BEGIN(section) at the start of a section and PROFILE_END(section)
+ * at the end (in the same block). The count, minimum, maximum and average
+ * time of each section are kept and can be printed with profiler_dump().
+ * A section must take less than 65ms (the timer wraps after that). Time
+ * spent in interrupt handlers is included in any section they interrupt.
+ *
+ * All of this is only compiled in if PROFILING is defined - otherwise the
+ * macros and functions below do nothing and cost nothing.
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdint.h>
+
+// Sections we measure
+#define PROFILE_MAIN_LOOP		0	// one pass of the play_game() loop (not sleeping)
+#define PROFILE_SCROLL_LANE		1	// scroll_vehicle_lane()
+#define PROFILE_SCROLL_RIVER	2	// scroll_river_channel()
+#define PROFILE_REDRAW_RIVER	3	// redraw_river_channel()
+#define PROFILE_TIMER0_ISR		4	// timer 0 interrupt handler
+#define PROFILE_SPI_STALL		5	// waiting for room in the SPI queue
+#define PROFILE_NUM_SECTIONS	6
+
+#ifdef PROFILING
+
+// Start timer 1 and clear the statistics.
+void init_profiler(void);
+
+// Return the current timer 1 count.
+uint16_t profiler_time(void);
+
+// Add a measurement for the given section which started at the given
+// timer 1 count and ends now. (Each section must only be measured from
+// one place - main program or interrupt handler - not both.)
+void profiler_record(uint8_t section, uint16_t start_time);
+
+// Print the statistics for each section (in microseconds) and then clear
+// them. This waits for room in the serial output buffer.
+void profiler_dump(void);
+
+#define PROFILE_BEGIN(section) uint16_t profile_start_##section = profiler_time()
+#define PROFILE_END(section) profiler_record(section, profile_start_##section)
+
+#else
+
+#define init_profiler()
+#define profiler_dump()
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+
+#endif /* PROFILING */
+
+#endif /* PROFILER_H_ */
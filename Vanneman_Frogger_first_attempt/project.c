@@ -9,43 +9,88 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#include <avr/sleep.h>
 #include <stdio.h>
 
 #include "ledmatrix.h"
 #include "scrolling_char_display.h"
+#include "font.h"
 #include "buttons.h"
 #include "serialio.h"
 #include "terminalio.h"
 #include "score.h"
 #include "timer0.h"
 #include "game.h"
-
-#define F_CPU 8000000L
-#include <util/delay.h>
+#include "scheduler.h"
+#include "input.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "levels.h"
+#include "input_log.h"
+#include "high_scores.h"
+#include "autopilot.h"
 
 // Function prototypes - these are defined below (after main()) in the order
 // given here
 void initialise_hardware(void);
-void splash_screen(void);
-void new_game(void);
-void play_game(void);
-void handle_game_over(void);
-void update_score(void);
-void update_level(uint32_t level);
+uint8_t splash_screen(void);
+void new_game(uint8_t demo);
+uint8_t play_game(uint8_t demo);
+uint8_t handle_game_over(void);
+static uint8_t play_demo(void);
+static uint8_t idle_too_long(void);
+static void update_hud(uint32_t level);
+static void toggle_telemetry(void);
+static void update_telemetry(void);
 void pause_game();
+static void schedule_lanes(uint32_t current_time);
+static void idle_until_next_event(void);
+static uint8_t start_game_requested(void);
+static void show_high_scores(int8_t new_place);
+static void print_line_P(uint8_t x, uint8_t y, PGM_P text);
+static void scroll_text(uint8_t index, int8_t direction);
+static void start_level_banner(uint32_t level);
+
+// If nobody does anything on the splash or game over screen for
+// ATTRACT_DELAY ms, the autopilot plays a demo game. last_input_time is
+// when the last input arrived on those screens.
+#define ATTRACT_DELAY 20000
 
-static uint32_t time_paused = 0;
-static uint32_t begin_pause;
-static uint8_t paused = 0;
+// Room in the serial output buffer for one line of a text screen (the
+// longest line plus its cursor move). Each line waits for this much room
+// so that none is cut short if the output is set to drop characters.
+#define SCREEN_LINE_SPACE 64
+static uint32_t last_input_time;
 
-// For Auto Repeat
-uint8_t project_last_button_state;
-uint8_t possible_button_states[4] = {1, 2, 4, 8};
-uint32_t frog_last_moved;
+// Messages on the LED matrix are scrolled one column at a time by a
+// scheduled task, every SPLASH_SCROLL_PERIOD ms for the splash screen
+// and BANNER_SCROLL_PERIOD ms for the level banner. text_scrolling is
+// 1 until the message has gone off the display.
+#define SPLASH_SCROLL_PERIOD 150
+#define BANNER_SCROLL_PERIOD 40
+static uint8_t text_scrolling;
 
+// "FROGGER 45258839" for the splash screen, turned into columns of dots
+// when the program is compiled
+static const uint8_t splash_banner[] PROGMEM = {
+	FONT_GAP, FONT_F, FONT_GAP, FONT_R, FONT_GAP, FONT_O, FONT_GAP, FONT_G,
+	FONT_GAP, FONT_G, FONT_GAP, FONT_E, FONT_GAP, FONT_R, FONT_GAP,
+	FONT_GAP, FONT_4, FONT_GAP, FONT_5, FONT_GAP, FONT_2, FONT_GAP, FONT_5,
+	FONT_GAP, FONT_8, FONT_GAP, FONT_8, FONT_GAP, FONT_3, FONT_GAP, FONT_9
+};
 
-// ASCII code for Escape character
-#define ESCAPE_CHAR 27
+// Telemetry. We send a tick and loop timing every TELEMETRY_TICK_PERIOD ms
+// and the frog, lanes and score whenever they change - these variables
+// hold the values last sent. The loop timing is the number of times
+// through the play_game() loop and the longest time (ms) spent in the
+// loop (not including sleeping) since the last sample.
+#define TELEMETRY_TICK_PERIOD 1000
+static uint32_t next_telemetry_tick;
+static uint8_t telemetry_frog[3];
+static uint16_t telemetry_lanes[TELEMETRY_NUM_LANES];
+static uint32_t telemetry_score;
+static uint16_t loop_iterations;
+static uint16_t longest_loop;
 
 /////////////////////////////// main //////////////////////////////////
 int main(void) {
@@ -53,14 +98,18 @@ int main(void) {
 	// interrupts.
 	initialise_hardware();
 	
-	// Show the splash screen message. Returns when display
-	// is complete
-	splash_screen();
+	// Show the splash screen message. Returns when a game is to start
+	// (or a demo if nobody starts one)
+	uint8_t start_game = splash_screen();
 	
 	while(1) {
-		new_game();
-		play_game();
-		handle_game_over();
+		if(start_game) {
+			new_game(0);
+			play_game(0);
+			start_game = handle_game_over();
+		} else {
+			start_game = play_demo();
+		}
 	}
 }
 
@@ -69,281 +118,466 @@ void initialise_hardware(void) {
 	init_button_interrupts();
 	
 	// Setup serial port for 19200 baud communication with no echo
-	// of incoming characters
-	init_serial_stdio(19200,0);
+	// of incoming characters. If the output buffer fills up we drop
+	// output rather than stall the game (the HUD never sends more than
+	// there is room for).
+	init_serial_stdio(19200,0,SERIAL_OUTPUT_DROP);
 	
 	init_timer0();
+	init_profiler();
+	init_input_log();
+	init_high_scores();
 	
 	// Turn on global interrupts
 	sei();
 }
 
-void splash_screen(void) {
+// Returns 1 when a game should start, or 0 if nobody has done anything
+// for ATTRACT_DELAY ms
+uint8_t splash_screen(void) {
 	// Clear terminal screen and output a message
+	serial_wait_for_output_space(SCREEN_LINE_SPACE);
 	clear_terminal();
-	move_cursor(10,10);
-	printf_P(PSTR("Frogger by 46258839"));
-	move_cursor(10,12);
-	printf_P(PSTR("CSSE2010 project by Rebecca Vanneman"));
+	print_line_P(10, 10, PSTR("Frogger by 46258839"));
+	print_line_P(10, 12, PSTR("CSSE2010 project by Rebecca Vanneman"));
 	
-	// Output the scrolling message to the LED matrix
+	// Output the scrolling message to the LED matrix (over and over)
 	// and wait for a push button to be pushed.
 	ledmatrix_clear();
-	while(1) {
-		set_scrolling_display_text("FROGGER 45258839", COLOUR_GREEN);
-		// Scroll the message until it has scrolled off the 
-		// display or a button is pushed
-		while(scroll_display()) {
-			_delay_ms(150);
-			if(button_pushed() != NO_BUTTON_PUSHED) {
-				return;
-			}
+	scheduler_init();
+	scheduler_add(scroll_text, 0, 0, SPLASH_SCROLL_PERIOD, get_game_time());
+	text_scrolling = 0;
+	last_input_time = get_current_time();
+	while(!start_game_requested()) {
+		if(idle_too_long()) {
+			scheduler_init();
+			return 0;
 		}
+		if(!text_scrolling) {
+			set_scrolling_display_columns_P(splash_banner, sizeof(splash_banner),
+					COLOUR_GREEN);
+			text_scrolling = 1;
+		}
+		scheduler_run_next_due(get_game_time());
+		idle_until_next_event();
 	}
+	scheduler_init();
+	return 1;
 }
 
-void new_game(void) {
+// Set up a new game. A demo game (played by the autopilot) isn't logged,
+// so the input log still holds the last game someone played.
+void new_game(uint8_t demo) {
+#ifdef LEVEL_SEED
+	// Generate endless levels from this seed instead of using the level
+	// pack (the same seed gives the same game every time)
+	set_level_generator(LEVEL_SEED);
+#endif
 	// Initialise the game and display
 	initialise_game();
 	
 	// Clear the serial terminal
 	clear_terminal();
 	
-	// Initialise the score and put score/level on serial terminal
+	// Initialise the score. The score, level etc. are put on the serial
+	// terminal by the HUD once the game starts.
 	init_score();
-	update_score();
-	update_level(1);
+	hud_init(get_current_time());
 	init_led();
 	
-	// Clear a button push or serial input if any are waiting
-	// (The cast to void means the return value is ignored.)
-	(void)button_pushed();
-	clear_serial_input_buffer();
+	// Clear any button pushes or serial input that are waiting
+	init_input();
+	
+	// Log the input from here on (or replay the last game's)
+	if(!demo) {
+		input_log_start_game(get_current_time());
+	}
 }
 
-void play_game(void) {
-	uint32_t current_time, last_move_time;
-	uint8_t road0, road1, road2, river0, river1;
-	road0 = road1 = road2 = river0 = river1 = 0;
-	int8_t button;
-	char serial_input, escape_sequence_char;
-	uint8_t characters_into_escape_sequence = 0;
+// Play until the frogs run out of lives. In a demo game the autopilot
+// plays and the game stops at the first input from anyone - returns 1 if
+// that was a button push (so a real game should start), 0 otherwise.
+uint8_t play_game(uint8_t demo) {
+	uint32_t current_time;
+	uint16_t loop_start_time; // only the bottom 16 bits - loops are short
+	InputEvent input;
 	uint32_t level = 1; // Specifies level
-	uint16_t speed_up_by = 0; // Rates will speed up each level it increases
+	uint8_t showing_banner = 0; // 1 while the level banner scrolls past
+	uint8_t autopilot_on = demo; // 1 if the autopilot plays player 1
+	uint8_t start_game = 0;
 	
 	// Start Countdown
 	
 	init_countdown();
-	// Get the current time and remember this as the last time the vehicles
-	// and logs were moved.
-	current_time = get_current_time();
-	last_move_time = current_time;
+	// Schedule the lanes to start moving from now
+	current_time = get_game_time();
+	schedule_lanes(current_time);
 	
 	// We play the game while the frog is alive and we haven't filled up the 
 	// far riverbank
 	while(!is_frog_dead()) {
+		loop_start_time = get_current_time_16();
+		PROFILE_BEGIN(PROFILE_MAIN_LOOP);
 		
-		if (is_time_up()) {
+		// The autopilot only moves the frog while the lanes are moving
+		autopilot_set_active(autopilot_on && !game_clock_paused() && !showing_banner);
+		
+		update_countdown_display();
+		if(showing_banner) {
+			// The game is on hold until the banner has gone, then the new
+			// level starts
+			if(!text_scrolling) {
+				showing_banner = 0;
+				show_level();
+				init_countdown();
+				
+				// Each level has its own lane speeds and directions
+				schedule_lanes(get_game_time());
+			}
+		} else if (is_time_up()) {
 			// Frog ran out of time
 			decrement_lives();
 			if (!is_frog_dead()){
-				initialise_life(level);
+				initialise_life();
 				init_countdown();
 			}
 		}else if (!is_frog_dead() && is_riverbank_full()){
-			// If the riverbank is full and frog isn't dead, start a new level
-			// somehow use scroll_display to scroll level over -- check splash screen stuff
-			scroll_display();
+			// If the riverbank is full and frog isn't dead, start a new level.
+			// Its number scrolls across first - without holding up the
+			// loop, so input (e.g. pause) still works.
 			level++;
 			initialise_level(level);
-			update_level(level);
-			init_countdown();
-			
-			// Each level speeds up by 50 ms
-			speed_up_by = speed_up_by + 50;
-			
-		}
-		if(!is_frog_dead() && !is_decremented() && frog_has_reached_riverbank()) {
-			// Frog reached the other side successfully but the
-			// riverbank isn't full, put a new frog at the start
-			put_frog_in_start_position();
-			
 			init_countdown();
+			start_level_banner(level);
+			showing_banner = 1;
+		} else if(!is_frog_dead() && !is_decremented()) {
+			// A frog that reached the other side successfully when the
+			// riverbank isn't full goes back to the start
+			for(uint8_t frog = 0; frog < NUM_FROGS; frog++) {
+				if(frog_has_reached_riverbank(frog)) {
+					put_frog_in_start_position(frog);
+					init_countdown();
+				}
+			}
 		} else if (is_decremented() && !is_frog_dead()) {
-			initialise_life(level);
+			initialise_life();
 			
 			init_countdown();
 		}
 		
-		// Check for input - which could be a button push or serial input.
-		// Serial input may be part of an escape sequence, e.g. ESC [ D
-		// is a left cursor key press. At most one of the following three
-		// variables will be set to a value other than -1 if input is available.
-		// (We don't initalise button to -1 since button_pushed() will return -1
-		// if no button pushes are waiting to be returned.)
-		// Button pushes take priority over serial input. If there are both then
-		// we'll retrieve the serial input the next time through this loop
-		serial_input = -1;
-		escape_sequence_char = -1;
-		button = button_pushed();
-		
-		if(button == NO_BUTTON_PUSHED) {
-			// No push button was pushed, see if there is any serial input
-			if(serial_input_available()) {
-				// Serial data was available - read the data from standard input
-				serial_input = fgetc(stdin);
-				// Check if the character is part of an escape sequence
-				if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
-					// We've hit the first character in an escape sequence (escape)
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 1 && serial_input == '[') {
-					// We've hit the second character in an escape sequence
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 2) {
-					// Third (and last) character in the escape sequence
-					escape_sequence_char = serial_input;
-					serial_input = -1;  // Don't further process this character - we
-										// deal with it as part of the escape sequence
-					characters_into_escape_sequence = 0;
-				} else {
-					// Character was not part of an escape sequence (or we received
-					// an invalid second character in the sequence). We'll process 
-					// the data in the serial_input variable.
-					characters_into_escape_sequence = 0;
+		// Check for input - which could be a button push, a button being
+		// held down or serial input. We deal with at most one input event
+		// each time through this loop.
+		if(get_input_event(&input)) {
+			if(demo && input.source != INPUT_FROM_AUTOPILOT) {
+				// Someone wants to play - stop the demo
+				start_game = (input.source == INPUT_FROM_BUTTON && 
+						input.kind == INPUT_PRESS);
+				break;
+			} else if(input.action == INPUT_PAUSE) {
+				pause_game();
+			} else if(input.action == INPUT_SAFE_DISPLAY) {
+				// Display looks corrupted - drop back to the slow SPI speed
+				// and resend everything
+				ledmatrix_use_safe_spi_speed();
+				ledmatrix_repaint();
+			} else if(input.action == INPUT_TELEMETRY) {
+				toggle_telemetry();
+			} else if(input.action == INPUT_PROFILE) {
+				profiler_dump();
+			} else if(input.action == INPUT_AUTOPILOT) {
+				autopilot_on = !autopilot_on;
+			} else if(!game_clock_paused() && !showing_banner) {
+				// With two players, the buttons (and the autopilot) move
+				// frog 0 and the serial terminal frog 1
+				uint8_t frog = (NUM_FROGS > 1 && input.source == INPUT_FROM_SERIAL);
+				switch(input.action) {
+					case INPUT_MOVE_LEFT:
+						move_frog_to_left(frog);
+						break;
+					case INPUT_MOVE_RIGHT:
+						move_frog_to_right(frog);
+						break;
+					case INPUT_MOVE_FORWARD:
+						move_frog_forward(frog);
+						break;
+					case INPUT_MOVE_BACKWARD:
+						move_frog_backward(frog);
+						break;
 				}
 			}
 		}
 		
-		project_last_button_state = show_button_state();
-		// Process the input. 
-		if(!paused && (button==3 || escape_sequence_char=='D' || serial_input=='L' || serial_input=='l')) {
-			// Attempt to move left
-			move_frog_to_left();
-			frog_last_moved = get_current_time();
-			project_last_button_state = 0;
-		} else if(!paused && (button==2 || escape_sequence_char=='A' || serial_input=='U' || serial_input=='u')) {
-			// Attempt to move forward
-			move_frog_forward();
-			frog_last_moved = get_current_time();
-			project_last_button_state = 0;
-			update_score();
-			update_level(level);
-		} else if(!paused && (button==1 || escape_sequence_char=='B' || serial_input=='D' || serial_input=='d')) {
-			// Attempt to move down
-			move_frog_backward();
-			frog_last_moved = get_current_time();
-			project_last_button_state = 0;
-		} else if(!paused && (button==0 || escape_sequence_char=='C' || serial_input=='R' || serial_input=='r')) {
-			// Attempt to move right
-			move_frog_to_right();
-			frog_last_moved = get_current_time();
-			project_last_button_state = 0;
-		} else if(serial_input == 'p' || serial_input == 'P') {
-			pause_game();
-		}  else if (!paused && ((get_current_time() - 300) >= frog_last_moved)) {
-
-			if (project_last_button_state == possible_button_states[0]){
-				move_frog_to_right();	
-			} else if (project_last_button_state == possible_button_states[1]){
-				move_frog_backward();
-			} else if(project_last_button_state == possible_button_states[2]){
-				move_frog_forward();
-			} else if (project_last_button_state == possible_button_states[3]){
-				move_frog_to_left();
+		// Scroll every lane that is due (lanes due at the same time then
+		// go to the display together). At most one run each per task, so
+		// input is still checked often if we fall behind.
+		if(!game_clock_paused() && !is_frog_dead()) {
+			current_time = get_game_time();
+			for(uint8_t i = 0; i < SCHEDULER_MAX_TASKS && 
+					scheduler_run_next_due(current_time); i++) {
+				;
 			}
-			frog_last_moved = get_current_time();
-			project_last_button_state = 0;
-		// No other if statements added because if multiple buttons pushed
-		// We ignore both buttons
 		}
 		
-			
-
-		current_time = get_current_time();
-		if(!paused && !is_frog_dead() && !road2 && current_time - time_paused >= last_move_time + 750 - speed_up_by) {
-			// 1000ms (1 second) has passed since the last time we moved
-			// the vehicles and logs - move them again and keep track of
-			// the time when we did this. 
-			scroll_vehicle_lane(2, 1);
-			road2 = 1;
-		} 	
-		if(!paused && !is_frog_dead() && !river0 && current_time - time_paused >= last_move_time + 850 - speed_up_by) {
-			scroll_river_channel(0, -1);
-			river0 = 1;
-
-		}
-		if(!paused && !is_frog_dead() && !road0 && current_time - time_paused >= last_move_time + 1000 - speed_up_by) {
-			scroll_vehicle_lane(0, 1);
-			road0 = 1;
-		}
-		if(!paused && !is_frog_dead() && !river1 && current_time - time_paused >= last_move_time + 1200 - speed_up_by) {
-			scroll_river_channel(1, 1);
-			river1 = 1;
+		// Send this time through the loop's changes to the LED matrix
+		frame_commit();
+		
+		// Send any changes to the score etc. to the terminal (or host)
+		if(telemetry_enabled()) {
+			update_telemetry();
+		} else {
+			update_hud(level);
 		}
-		if(!paused && !is_frog_dead() && !road1 && current_time - time_paused >= last_move_time + 1300 -speed_up_by) {
-			scroll_vehicle_lane(1, -1);
-			last_move_time = current_time;
-			road0 = road1 = road2 = river0 = river1 = 0;
-			time_paused = 0;
+		
+		// Record how long we spent in the loop this time
+		PROFILE_END(PROFILE_MAIN_LOOP);
+		loop_iterations++;
+		loop_start_time = get_current_time_16() - loop_start_time;
+		if(loop_start_time > longest_loop) {
+			longest_loop = loop_start_time;
 		}
+		
+		// Sleep if there is nothing else to do until the next interrupt
+		idle_until_next_event();
 	}
-	// We get here if the frog is dead.
-	// The game is over.
+	// We get here if the frog is dead (or the demo was stopped).
+	// The game is over. Stop the lanes until the next game starts.
+	scheduler_init();
+	autopilot_set_active(0);
+	resume_game_clock();
+	input_log_end_game();
+	return start_game;
+}
+
+// Let the autopilot play a game while nobody is playing. Returns 1 if a
+// real game should start straight afterwards (a button was pushed during
+// the demo), 0 if the splash screen timed out again.
+static uint8_t play_demo(void) {
+	new_game(1);
+	print_line_P(10, 14, PSTR("DEMO - press a button to play"));
+	if(play_game(1)) {
+		return 1;
+	}
+	return splash_screen();
 }
 
 
-void handle_game_over() {
-	move_cursor(10,14);
-	printf_P(PSTR("GAME OVER"));
-	move_cursor(10,15);
-	printf_P(PSTR("Press a button to start again"));
-	while(button_pushed() == NO_BUTTON_PUSHED) {
-		; // wait
+// Returns 1 when a new game should start, or 0 if nobody has done anything
+// for ATTRACT_DELAY ms
+uint8_t handle_game_over() {
+	show_high_scores(add_high_score(get_score()));
+	print_line_P(10, 14, PSTR("GAME OVER"));
+	print_line_P(10, 15, PSTR("Press a button to start again"));
+	print_line_P(10, 16, PSTR("(! replays that game, E saves it, # lists its input)"));
+	last_input_time = get_current_time();
+	while(!start_game_requested()) {
+		if(idle_too_long()) {
+			return 0;
+		}
+		update_countdown_display();
+		idle_until_next_event(); // wait
 	}
-	
+	return 1;
 }
 
-void update_score() {
-	clear_terminal();
-	move_cursor(30,2);
-	//printf_P(PSTR("\x1b[K"));
-	printf_P(PSTR("Score:"));
+// Deal with any input on the splash screen or game over screen. Returns 1
+// if a new game should start - a button was pushed, or ! was typed to
+// replay the last game. The input log can also be printed or saved.
+static uint8_t start_game_requested(void) {
+	InputEvent input;
 	
-	int score = get_score();
-	if (score < 10) {
-		move_cursor(40,2);
-	} else if (score >10 && score < 100) {
-		move_cursor(39,2);
-	} else if (score > 100 && score < 1000){
-		move_cursor(38,2);
-	} else if (score > 1000 && score < 10000){
-		move_cursor(37,2);
+	if(!get_input_event(&input)) {
+		return 0;
+	}
+	last_input_time = get_current_time();
+	if(input.source == INPUT_FROM_BUTTON) {
+		return input.kind == INPUT_PRESS;
 	}
-	printf_P(PSTR("%d"), score);
+	switch(input.action) {
+		case INPUT_REPLAY:
+			return input_log_replay_next_game();
+		case INPUT_DUMP_LOG:
+			input_log_dump();
+			break;
+		case INPUT_SAVE_LOG:
+			// This takes a while - wait for the high scores first so
+			// the EEPROM is free
+			wait_for_high_scores_saved();
+			input_log_save();
+			print_line_P(10, 17, PSTR("Input log saved"));
+			break;
+	}
+	return 0;
 }
 
-void update_level(uint32_t level) {
-	move_cursor(30,3);
-	printf_P(PSTR("Level %d"), level);
+// Return 1 if there has been no input on the splash or game over screen
+// for ATTRACT_DELAY ms
+static uint8_t idle_too_long(void) {
+	return get_current_time() - last_input_time >= ATTRACT_DELAY;
 }
 
-void pause_game() {
-	// Game is already paused, unpause
-	if (paused == 1){
-		uint32_t now = get_current_time();
-		time_paused = now - begin_pause;
-		paused = 0;
-		countdown_pause();
+// List the high scores on the terminal, marking the one just added (if
+// new_place isn't -1)
+static void show_high_scores(int8_t new_place) {
+	print_line_P(10, 19, PSTR("High scores"));
+	for(uint8_t i = 0; i < NUM_HIGH_SCORES && get_high_score(i) > 0; i++) {
+		serial_wait_for_output_space(SCREEN_LINE_SPACE);
+		move_cursor(10,20 + i);
+		printf_P(PSTR("%u. %7lu%S"), i + 1, get_high_score(i),
+				i == new_place ? PSTR(" new!") : PSTR(""));
+	}
+}
+
+// Print a line of a text screen at the given position once there is room
+// for all of it in the serial output buffer
+static void print_line_P(uint8_t x, uint8_t y, PGM_P text) {
+	serial_wait_for_output_space(SCREEN_LINE_SPACE);
+	move_cursor(x, y);
+	printf_P(text);
+}
+
+// Scheduled task which scrolls the message on the LED matrix one column
+static void scroll_text(uint8_t index, int8_t direction) {
+	(void)index;
+	(void)direction;
+	text_scrolling = scroll_display();
+}
+
+// Scroll "LEVEL n" across the display. The lanes are stopped until it
+// has finished.
+static void start_level_banner(uint32_t level) {
+	char text[16];
+	
+	snprintf_P(text, sizeof(text), PSTR("LEVEL %lu"), level);
+	set_scrolling_display_text(text, COLOUR_ORANGE);
+	text_scrolling = 1;
+	scheduler_init();
+	scheduler_add(scroll_text, 0, 0, BANNER_SCROLL_PERIOD, get_game_time());
+}
+
+// Give the HUD the latest values. It only sends what has changed, a
+// frame at a time, so this is cheap to call every time through the loop.
+static void update_hud(uint32_t level) {
+	hud_set_field(HUD_SCORE, get_score());
+	hud_set_field(HUD_LEVEL, level);
+	hud_set_field(HUD_LIVES, num_frog_lives());
+	hud_set_field(HUD_COUNTDOWN, countdown_seconds_remaining());
+	hud_update(get_current_time());
+}
+
+// Switch between the terminal display and sending telemetry
+static void toggle_telemetry(void) {
+	if(telemetry_enabled()) {
+		// Back to the terminal - redraw it from scratch
+		telemetry_enable(0);
+		clear_terminal();
+		hud_init(get_current_time());
 	} else {
-		// Pause Game
-		begin_pause = get_current_time();
-		paused = 1;
-		countdown_pause();
+		// Make sure everything is sent straight away
+		telemetry_enable(1);
+		next_telemetry_tick = get_current_time();
+		telemetry_frog[0] = 0xFF;
+		telemetry_lanes[0] = 0xFFFF;
+		telemetry_score = get_score();
+		telemetry_send_score(0, telemetry_score);
 	}
 }
 
+// Send telemetry for anything that has changed. If a record can't be sent
+// (no room in the serial output buffer) we try again next time.
+static void update_telemetry(void) {
+	uint32_t current_time = get_current_time();
+	uint8_t frog[3];
+	uint16_t lanes[TELEMETRY_NUM_LANES];
+	uint8_t i;
+	
+	if(time_after_eq(current_time, next_telemetry_tick)) {
+		next_telemetry_tick = current_time + TELEMETRY_TICK_PERIOD;
+		telemetry_send_tick(current_time);
+		telemetry_send_loop_timing(loop_iterations, longest_loop);
+		loop_iterations = 0;
+		longest_loop = 0;
+	}
+	
+	// (Only player 1's frog is reported)
+	frog[0] = get_frog_row(0);
+	frog[1] = get_frog_column(0);
+	frog[2] = num_frog_lives();
+	for(i = 0; i < 3 && frog[i] == telemetry_frog[i]; i++) {
+		;
+	}
+	if(i < 3 && telemetry_send_frog(frog[0], frog[1], frog[2])) {
+		for(i = 0; i < 3; i++) {
+			telemetry_frog[i] = frog[i];
+		}
+	}
+	
+	for(i = 0; i < 3; i++) {
+		lanes[i] = get_lane_position(i);
+	}
+	lanes[3] = get_log_position(0);
+	lanes[4] = get_log_position(1);
+	for(i = 0; i < TELEMETRY_NUM_LANES && lanes[i] == telemetry_lanes[i]; i++) {
+		;
+	}
+	if(i < TELEMETRY_NUM_LANES && telemetry_send_lanes(lanes)) {
+		for(i = 0; i < TELEMETRY_NUM_LANES; i++) {
+			telemetry_lanes[i] = lanes[i];
+		}
+	}
+	
+	if(get_score() != telemetry_score && 
+			telemetry_send_score(get_score() - telemetry_score, get_score())) {
+		telemetry_score = get_score();
+	}
+}
 
+void pause_game() {
+	// The lanes and countdown run on the game clock, so stopping it stops
+	// them all where they are and starting it again carries them on
+	if (game_clock_paused()){
+		resume_game_clock();
+	} else {
+		pause_game_clock();
+	}
+}
 
+// Schedule each traffic lane and river channel to scroll in its own
+// direction on its own period (in ms), as given by the current level,
+// starting from current_time. Each lane goes in the scheduler slot with
+// its pattern number (see levels.h) - the autopilot relies on this.
+static void schedule_lanes(uint32_t current_time) {
+	const LevelSettings* level = current_level();
+	uint8_t i;
+	
+	scheduler_init();
+	for(i = 0; i < NUM_TRAFFIC_LANES; i++) {
+		scheduler_add(scroll_vehicle_lane, i, level->lanes[i].direction,
+				level->lanes[i].period, current_time);
+	}
+	for(i = 0; i < NUM_RIVER_CHANNELS; i++) {
+		scheduler_add(scroll_river_channel, i, level->channels[i].direction,
+				level->channels[i].period, current_time);
+	}
+}
 
+// Put the CPU into idle sleep until the next interrupt (the 1ms timer
+// tick, a button push, serial input etc.) unless we already have input
+// waiting or a lane is due to scroll. The peripherals and their interrupts
+// keep running while we're idle so SPI and serial output carry on.
+static void idle_until_next_event(void) {
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	// Interrupts are turned off while we check, so that an interrupt that
+	// arrives after we check can't be missed. Interrupts are turned back on
+	// just before sleeping - the instruction after sei() is always executed
+	// before any pending interrupt is handled so we will still wake for it.
+	cli();
+	if(!input_waiting() &&
+			(game_clock_paused() || scheduler_ms_until_next(get_game_time()) > 0)) {
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+	sei();
+}
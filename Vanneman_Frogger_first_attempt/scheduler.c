@@ -0,0 +1,98 @@
+/*
+ * scheduler.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include "scheduler.h"
+#include "timer0.h"
+
+typedef struct {
+	ScheduledTask task;
+	uint8_t index;
+	int8_t direction;
+	uint16_t period;
+	uint32_t next_deadline;
+} ScheduleEntry;
+
+static ScheduleEntry schedule[SCHEDULER_MAX_TASKS];
+static uint8_t num_tasks;
+
+// Slot of the task with the earliest deadline (only valid if num_tasks > 0)
+static uint8_t next_slot;
+
+static void find_next_slot(void);
+
+void scheduler_init(void) {
+	num_tasks = 0;
+	next_slot = 0;
+}
+
+int8_t scheduler_add(ScheduledTask task, uint8_t index, int8_t direction,
+		uint16_t period, uint32_t now) {
+	if(num_tasks >= SCHEDULER_MAX_TASKS) {
+		return -1;
+	}
+	ScheduleEntry* entry = &schedule[num_tasks];
+	entry->task = task;
+	entry->index = index;
+	entry->direction = direction;
+	entry->period = period;
+	entry->next_deadline = now + period;
+	num_tasks++;
+	find_next_slot();
+	return num_tasks - 1;
+}
+
+uint32_t scheduler_next_deadline(uint8_t slot) {
+	return schedule[slot].next_deadline;
+}
+
+uint16_t scheduler_period(uint8_t slot) {
+	return schedule[slot].period;
+}
+
+uint8_t scheduler_run_next_due(uint32_t now) {
+	if(num_tasks == 0 || time_before(now, schedule[next_slot].next_deadline)) {
+		// Nothing due yet
+		return 0;
+	}
+	ScheduleEntry* entry = &schedule[next_slot];
+
+	// Work out the next deadline before running the task. We advance by
+	// exactly one period so the task doesn't drift - unless we've fallen
+	// more than a whole period behind, in which case we skip the missed
+	// runs rather than running the task several times in a row.
+	entry->next_deadline += entry->period;
+	if(!time_before(now, entry->next_deadline)) {
+		entry->next_deadline = now + entry->period;
+	}
+	find_next_slot();
+
+	entry->task(entry->index, entry->direction);
+	return 1;
+}
+
+uint16_t scheduler_ms_until_next(uint32_t now) {
+	if(num_tasks == 0) {
+		return 0xFFFF;
+	}
+	uint32_t deadline = schedule[next_slot].next_deadline;
+	if(!time_before(now, deadline)) {
+		return 0;
+	}
+	if(deadline - now > 0xFFFE) {
+		return 0xFFFE;
+	}
+	return deadline - now;
+}
+
+// Update next_slot to be the slot with the earliest deadline
+static void find_next_slot(void) {
+	next_slot = 0;
+	for(uint8_t i = 1; i < num_tasks; i++) {
+		if(time_before(schedule[i].next_deadline, schedule[next_slot].next_deadline)) {
+			next_slot = i;
+		}
+	}
+}
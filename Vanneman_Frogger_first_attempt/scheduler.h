@@ -0,0 +1,49 @@
+/*
+ * scheduler.h
+ *
+ * Author: Becca Vanneman
+ *
+ * A small table of periodic tasks (e.g. scrolling a lane of traffic). Each
+ * task has its own period and the time it is next due. Deadlines advance
+ * by exactly one period each time a task runs so tasks don't drift, and
+ * the earliest deadline is kept up to date so finding the next task to
+ * run (or how long until it is due) takes constant time.
+ * All times are game times in milliseconds, as returned by get_game_time()
+ * (see timer0.h) - so tasks stop while the game is paused and carry on
+ * where they were when it resumes.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+
+#define SCHEDULER_MAX_TASKS 8
+
+// Function called when a task is due. The index and direction given when
+// the task was added are passed to it (e.g. the lane number and scroll
+// direction for scroll_vehicle_lane()).
+typedef void (*ScheduledTask)(uint8_t index, int8_t direction);
+
+// Remove all tasks.
+void scheduler_init(void);
+
+// Add a task which will first run period ms after now. Returns the
+// task's slot number (used below), or -1 if the table is full.
+int8_t scheduler_add(ScheduledTask task, uint8_t index, int8_t direction,
+		uint16_t period, uint32_t now);
+
+// Return the time a task is next due and its period.
+uint32_t scheduler_next_deadline(uint8_t slot);
+uint16_t scheduler_period(uint8_t slot);
+
+// Run the task with the earliest deadline if it is due. Returns 1 if a
+// task was run, 0 otherwise. (If several tasks are due, call this again
+// to run the next one.)
+uint8_t scheduler_run_next_due(uint32_t now);
+
+// Return the number of milliseconds until the next task is due (0 if one
+// is already due, 0xFFFF if there are no tasks).
+uint16_t scheduler_ms_until_next(uint32_t now);
+
+#endif /* SCHEDULER_H_ */
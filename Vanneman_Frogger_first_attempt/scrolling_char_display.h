@@ -1,7 +1,7 @@
 /*
  * scrolling_char_display.h
  *
- * Author: Peter Sutton
+ * Author: Peter Sutton. Modified by Becca Vanneman
  */
 
 #ifndef SCROLLING_CHAR_DISPLAY_H_
@@ -10,23 +10,36 @@
 #include <stdint.h>
 #include "pixel_colour.h"
 
+/* Most columns of dots a message set by set_scrolling_display_text()
+ * can have (each character takes 4 to 6). The message is cut short
+ * before the first character that doesn't fit completely.
+ */
+#define SCROLLING_TEXT_MAX_COLUMNS 64
+
 /* Sets the text to be displayed and the colour it will be
  * scrolled with. The message will start displaying immediately
  * so will overwrite/interfere with any currently scrolling
  * message. To avoid this, wait until the scroll_display()
  * function below has returned 0 to indicate the message scrolling
- * is complete. Note that this string is not 
- * copied, so it is important that this string not change
- * after this function is called while the string is still
- * being displayed.
+ * is complete. The text is turned into columns of dots straight
+ * away, so the string can change (or be a temporary buffer, e.g.
+ * holding "LEVEL 12") once this returns.
+ */
+void set_scrolling_display_text(const char* string, PixelColour colour);
+
+/* As above, but for a message that has already been turned into length
+ * columns of dots in program memory (see font.h). For constant text this
+ * saves rendering it at run time and the RAM it would take.
  */
-void set_scrolling_display_text(char* string, PixelColour colour);
+void set_scrolling_display_columns_P(const uint8_t* columns, uint8_t length,
+		PixelColour colour);
 
 /* Scroll the display. Should be called whenever the display
  * is to be scrolled one pixel to the left. It is recommended that
  * this function NOT be called from an interrupt service routine as
- * it will wait for SPI communication to be finished before returning. 
- * This could take over 1ms.
+ * it may wait for space in the SPI transmit queue before returning. 
+ * This could take over 1ms. It doesn't wait between columns - call
+ * it at the scrolling rate (e.g. as a scheduled task).
  * Returns 1 while a message is still scrolling, 0 when done.
  */
 uint8_t scroll_display(void);
@@ -10,8 +10,12 @@
  * to print many characters at once to the buffer and have them 
  * output by the UART as speed permits.) If the buffer fills up, the
  * put method will either
- * (1) if interrupts are enabled, block until there is room in it, or
- * (2) if interrupts are disabled, will discard the character.
+ * (1) if interrupts are enabled and the output mode is SERIAL_OUTPUT_BLOCK,
+ *     block until there is room in it,
+ * (2) if the output mode is SERIAL_OUTPUT_OVERWRITE, throw away the oldest
+ *     character in the buffer to make room, or
+ * (3) otherwise (SERIAL_OUTPUT_DROP, or interrupts are disabled) discard 
+ *     the character.
  * Input is blocking - requesting input from stdin will block
  * until a character is available. If interrupts are disabled when 
  * input is sought, then this will block forever.
@@ -26,6 +30,8 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
+#include "serialio.h"
+
 /* System clock rate in Hz. (L at the end indicates this is a long constant) */
 #define SYSCLK 8000000L
 
@@ -38,31 +44,63 @@
  * prior to the current insert_pos are the bytes waiting to be output.
  * If the insert_pos reaches the end of the buffer it will wrap around
  * to the beginning (assuming those bytes have been output).
- * NOTE - OUTPUT_BUFFER_SIZE can not be larger than 255 without changing
- * the type of the variables below (currently defined as 8 bit unsigned ints).
+ * OUTPUT_BUFFER_SIZE can be set at compile time (SERIAL_OUTPUT_BUFFER_SIZE).
+ * If it is larger than 255 the variables below become 16 bits, which
+ * can't be read in one instruction, so they must only be read with 
+ * interrupts disabled.
+ * out_dropped counts the characters thrown away because the buffer was 
+ * full and out_high_water is the most characters that have been in the
+ * buffer at once.
  */
+#ifdef SERIAL_OUTPUT_BUFFER_SIZE
+#define OUTPUT_BUFFER_SIZE SERIAL_OUTPUT_BUFFER_SIZE
+#else
 #define OUTPUT_BUFFER_SIZE 255
+#endif
+#if OUTPUT_BUFFER_SIZE > 255
+typedef uint16_t out_index_t;
+#else
+typedef uint8_t out_index_t;
+#endif
 volatile char out_buffer[OUTPUT_BUFFER_SIZE];
-volatile uint8_t out_insert_pos;
-volatile uint8_t bytes_in_out_buffer;
+volatile out_index_t out_insert_pos;
+volatile out_index_t bytes_in_out_buffer;
+volatile out_index_t out_high_water;
+volatile uint16_t out_dropped;
 
-/* Circular buffer to hold incoming characters. Works on same principle
- * as output buffer
+/* Circular buffer to hold incoming characters. input_insert_pos is only
+ * changed by the receive interrupt handler and input_remove_pos is only
+ * changed when characters are read, so (as each is a single byte) neither
+ * side needs to turn interrupts off. The buffer is empty when they are
+ * equal so it can hold INPUT_BUFFER_SIZE-1 characters.
+ * input_overruns counts characters lost because the buffer was full or
+ * because the UART received another character before we read the last.
+ * INPUT_BUFFER_SIZE can be set at compile time (SERIAL_INPUT_BUFFER_SIZE)
+ * but must be a power of 2 no larger than 256.
  */
-#define INPUT_BUFFER_SIZE 16
+#ifdef SERIAL_INPUT_BUFFER_SIZE
+#define INPUT_BUFFER_SIZE SERIAL_INPUT_BUFFER_SIZE
+#else
+#define INPUT_BUFFER_SIZE 64
+#endif
+#define INPUT_BUFFER_MASK (INPUT_BUFFER_SIZE - 1)
 volatile char input_buffer[INPUT_BUFFER_SIZE];
 volatile uint8_t input_insert_pos;
-volatile uint8_t bytes_in_input_buffer;
-volatile uint8_t input_overrun;
+volatile uint8_t input_remove_pos;
+volatile uint16_t input_overruns;
 
 /* Variable to keep track of whether incoming characters are to be echoed
  * back or not.
  */
 static int8_t do_echo;
 
+/* What to do when the output buffer is full (SERIAL_OUTPUT_BLOCK etc.) */
+static uint8_t out_mode;
+
 /* Function prototypes 
  */
-void init_serial_stdio(long baudrate, int8_t echo);
+void init_serial_stdio(long baudrate, int8_t echo, uint8_t output_mode);
+static void add_to_out_buffer(char c);
 static int uart_put_char(char, FILE*);
 static int uart_get_char(FILE*);
 
@@ -72,21 +110,24 @@ static int uart_get_char(FILE*);
 static FILE myStream = FDEV_SETUP_STREAM(uart_put_char, uart_get_char,
 		_FDEV_SETUP_RW);
 
-void init_serial_stdio(long baudrate, int8_t echo) {
+void init_serial_stdio(long baudrate, int8_t echo, uint8_t output_mode) {
 	uint16_t ubrr;
 	/*
 	 * Initialise our buffers
 	*/
 	out_insert_pos = 0;
 	bytes_in_out_buffer = 0;
+	out_high_water = 0;
+	out_dropped = 0;
 	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
-	input_overrun = 0;
+	input_remove_pos = 0;
+	input_overruns = 0;
 	
 	/*
 	 * Record whether we're going to echo characters or not
 	*/
 	do_echo = echo;
+	out_mode = output_mode;
 	
 	/* Configure the serial port baud rate */
 	/* (This differs from the datasheet formula so that we get 
@@ -119,62 +160,175 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 }
 
 int8_t serial_input_available(void) {
-	return (bytes_in_input_buffer != 0);
+	return (input_insert_pos != input_remove_pos);
 }
 
 void clear_serial_input_buffer(void) {
 	/* Just adjust our buffer data so it looks empty */
-	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
+	input_remove_pos = input_insert_pos;
+}
+
+uint8_t serial_read(char* buffer, uint8_t max_length) {
+	uint8_t count = 0;
+	uint8_t remove_pos = input_remove_pos;
+	
+	/* Copy characters until the buffer is empty or we have enough. We
+	 * only update input_remove_pos at the end so the interrupt handler
+	 * can't overwrite characters we haven't copied yet.
+	 */
+	while(count < max_length && remove_pos != input_insert_pos) {
+		buffer[count++] = input_buffer[remove_pos];
+		remove_pos = (remove_pos + 1) & INPUT_BUFFER_MASK;
+	}
+	input_remove_pos = remove_pos;
+	return count;
+}
+
+uint16_t serial_input_overruns(void) {
+	uint16_t overruns;
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	overruns = input_overruns;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return overruns;
+}
+
+uint16_t serial_output_space(void) {
+	uint16_t space;
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	space = OUTPUT_BUFFER_SIZE - bytes_in_out_buffer;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return space;
+}
+
+void serial_wait_for_output_space(uint16_t length) {
+	if(length > OUTPUT_BUFFER_SIZE || !bit_is_set(SREG, SREG_I)) {
+		return;
+	}
+	while(serial_output_space() < length) {
+		/* do nothing - the interrupt handler empties the buffer */
+	}
+}
+
+int16_t serial_write(const char* data, uint16_t length) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	if(length > OUTPUT_BUFFER_SIZE - bytes_in_out_buffer) {
+		/* Not enough room - send none of it */
+		if(interrupts_enabled) {
+			sei();
+		}
+		return SERIAL_E_AGAIN;
+	}
+	for(uint16_t i = 0; i < length; i++) {
+		add_to_out_buffer(data[i]);
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+	return length;
+}
+
+uint16_t serial_output_dropped(void) {
+	uint16_t dropped;
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	dropped = out_dropped;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return dropped;
+}
+
+uint16_t serial_output_high_water(void) {
+	uint16_t high_water;
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	high_water = out_high_water;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return high_water;
+}
+
+/* Add a character to the output buffer. There must be room for it and
+ * interrupts must be disabled.
+ */
+static void add_to_out_buffer(char c) {
+	/* We advance the insert_pos to the next character position. If 
+	 * this is beyond the end of the buffer we wrap around back to the
+	 * beginning of the buffer 
+	 */
+	out_buffer[out_insert_pos++] = c;
+	bytes_in_out_buffer++;
+	if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
+		/* Wrap around buffer pointer if necessary */
+		out_insert_pos = 0;
+	}
+	if(bytes_in_out_buffer > out_high_water) {
+		out_high_water = bytes_in_out_buffer;
+	}
+	/* Make sure the UDR Empty interrupt is enabled (it is disabled
+	 * when the buffer empties) so that it will fire and deal with the 
+	 * next character in the buffer. */
+	UCSR0B |= (1 << UDRIE0);
 }
 
 static int uart_put_char(char c, FILE* stream) {
 	uint8_t interrupts_enabled;
 	
 	/* Add the character to the buffer for transmission (if there 
-	 * is space to do so). If not we wait until the buffer has space.
-	 * If the character is \n, we output \r (carriage return)
-	 * also.
+	 * is space to do so - see the top of this file for what happens
+	 * if there isn't). If the character is \n, we output \r (carriage
+	 * return) also.
 	*/
 	if(c == '\n') {
 		uart_put_char('\r', stream);
 	}
 	
-	/* If the buffer is full and interrupts are disabled then we
-	 * abort - we don't output the character since the buffer will
-	 * never be emptied if interrupts are disabled. If the buffer is full
-	 * and interrupts are enabled then we loop until the buffer has 
-	 * enough space. The bytes_in_buffer variable will get modified by the
-	 * ISR which extracts bytes from the buffer.
+	/* NOTE: we disable interrupts before looking at or modifying the 
+	 * buffer. This prevents the ISR from modifying the buffer at the same
+	 * time. We reenable them if they were enabled when we entered the
+	 * function. While we wait for room in blocking mode interrupts are
+	 * reenabled so the ISR can take bytes out of the buffer.
 	*/
 	interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
 	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
-		if(!interrupts_enabled) {
+		if(out_mode == SERIAL_OUTPUT_OVERWRITE) {
+			/* Forget the oldest character (the one furthest
+			 * before insert_pos) to make room for this one 
+			 */
+			bytes_in_out_buffer--;
+			out_dropped++;
+		} else if(out_mode == SERIAL_OUTPUT_DROP || !interrupts_enabled) {
+			/* Don't output the character. (If interrupts are 
+			 * disabled the buffer would never be emptied.) 
+			 */
+			out_dropped++;
+			if(interrupts_enabled) {
+				sei();
+			}
 			return 1;
-		}		
-		/* else do nothing */
-	}
-	
-	/* Add the character to the buffer for transmission if there
-	 * is space to do so. We advance the insert_pos to the next
-	 * character position. If this is beyond the end of the buffer
-	 * we wrap around back to the beginning of the buffer 
-	 * NOTE: we disable interrupts before modifying the buffer. This
-	 * prevents the ISR from modifying the buffer at the same time.
-	 * We reenable them if they were enabled when we entered the
-	 * function.
-	*/	
-	cli();
-	out_buffer[out_insert_pos++] = c;
-	bytes_in_out_buffer++;
-	if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
-		/* Wrap around buffer pointer if necessary */
-		out_insert_pos = 0;
+		} else {
+			/* Blocking - wait with interrupts on so the ISR can
+			 * make room, then check again. (The instruction after
+			 * sei() always runs before any pending interrupt, so
+			 * the wait can't be just sei(); cli();)
+			 */
+			sei();
+			while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+				/* do nothing */
+			}
+			cli();
+		}
 	}
-	/* Reenable interrupts (UDR Empty interrupt may have been
-	 * disabled) - we ensure it is now enabled so that it will
-	 * fire and deal with the next character in the buffer. */
-	UCSR0B |= (1 << UDRIE0);
+	add_to_out_buffer(c);
 	if(interrupts_enabled) {
 		sei();
 	}
@@ -182,34 +336,11 @@ static int uart_put_char(char c, FILE* stream) {
 }
 
 int uart_get_char(FILE* stream) {
+	char c;
 	/* Wait until we've received a character */
-	while(bytes_in_input_buffer == 0) {
+	while(serial_read(&c, 1) == 0) {
 		/* do nothing */
 	}
-	
-	/*
-	 * Turn interrupts off and remove a character from the input
-	 * buffer. We reenable interrupts if they were on.
-	 * The pending character is the one which is byte_in_input_buffer
-	 * characters before the insert position (taking into account
-	 * that we may need to wrap around).
-	 */
-	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
-	cli();
-	char c;
-	if(input_insert_pos - bytes_in_input_buffer < 0) {
-		/* Need to wrap around */
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer
-				+ INPUT_BUFFER_SIZE];
-	} else {
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer];
-	}
-	
-	/* Decrement our count of bytes in the input buffer */
-	bytes_in_input_buffer--;
-	if(interrupts_enabled) {
-		sei();
-	}	
 	return c;
 }
 
@@ -228,7 +359,7 @@ ISR(USART0_UDRE_vect)
 		 * need to wrap around to the end of the buffer).
 		 */
 		char c;
-		if(out_insert_pos - bytes_in_out_buffer < 0) {
+		if(bytes_in_out_buffer > out_insert_pos) {
 			/* Need to wrap around */
 			c = out_buffer[out_insert_pos - bytes_in_out_buffer
 				+ OUTPUT_BUFFER_SIZE];
@@ -261,7 +392,14 @@ ISR(USART0_UDRE_vect)
 
 ISR(USART0_RX_vect) 
 {
-	/* Read the character - we ignore the possibility of overrun. */
+	/* Check whether the UART lost a character before this one (this
+	 * must be checked before UDR0 is read)
+	 */
+	if(UCSR0A & (1<<DOR0)) {
+		input_overruns++;
+	}
+	
+	/* Read the character */
 	char c;
 	c = UDR0;
 		
@@ -275,13 +413,13 @@ ISR(USART0_RX_vect)
 	}
 	
 	/* 
-	 * Check if we have space in our buffer. If not, set the overrun
-	 * flag and throw away the character. (We never clear the 
-	 * overrun flag - it's up to the programmer to check/clear
-	 * this flag if desired.)
+	 * Check if we have space in our buffer. If not, count the overrun
+	 * and throw away the character. (It's up to the programmer to check
+	 * the count with serial_input_overruns() if desired.)
 	 */
-	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
-		input_overrun = 1;
+	uint8_t next_insert_pos = (input_insert_pos + 1) & INPUT_BUFFER_MASK;
+	if(next_insert_pos == input_remove_pos) {
+		input_overruns++;
 	} else {
 		/* If the character is a carriage return, turn it into a
 		 * linefeed 
@@ -293,11 +431,7 @@ ISR(USART0_RX_vect)
 		/* 
 		 * There is room in the input buffer 
 		 */
-		input_buffer[input_insert_pos++] = c;
-		bytes_in_input_buffer++;
-		if(input_insert_pos == INPUT_BUFFER_SIZE) {
-			/* Wrap around buffer pointer if necessary */
-			input_insert_pos = 0;
-		}
+		input_buffer[input_insert_pos] = c;
+		input_insert_pos = next_insert_pos;
 	}
 }
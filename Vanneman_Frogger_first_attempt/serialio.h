@@ -18,12 +18,28 @@
 
 #include <stdint.h>
 
+/* What happens to output when the output buffer is full:
+ * SERIAL_OUTPUT_BLOCK - wait until there is room (if interrupts are
+ *		disabled the character is dropped instead)
+ * SERIAL_OUTPUT_DROP - throw away the new character
+ * SERIAL_OUTPUT_OVERWRITE - throw away the oldest character waiting to be
+ *		sent (newest output wins - this may cut an escape sequence short)
+ * Dropped characters are counted (see serial_output_dropped()).
+ */
+#define SERIAL_OUTPUT_BLOCK 0
+#define SERIAL_OUTPUT_DROP 1
+#define SERIAL_OUTPUT_OVERWRITE 2
+
+/* Returned by serial_write() if there isn't room for the data */
+#define SERIAL_E_AGAIN (-1)
+
 /* Initialise serial IO using the UART. baudrate specifies the desired
  * baudrate (e.g. 19200) and echo determines whether incoming characters
  * are echoed back to the UART output as they are received (zero means no
- * echo, non-zero means echo)
+ * echo, non-zero means echo). output_mode is one of the SERIAL_OUTPUT_...
+ * values above.
  */
-void init_serial_stdio(long baudrate, int8_t echo);
+void init_serial_stdio(long baudrate, int8_t echo, uint8_t output_mode);
 
 /* Test if input is available from the serial port. Return 0 if not,
  * non-zero otherwise. If there is input available then it can be read
@@ -36,4 +52,42 @@ int8_t serial_input_available(void);
  */
 void clear_serial_input_buffer(void);
 
+/* Read up to max_length characters that are waiting in the serial input
+ * buffer into buffer (without waiting). Returns the number of characters
+ * read, which may be 0. (Characters are not null terminated.)
+ */
+uint8_t serial_read(char* buffer, uint8_t max_length);
+
+/* Return the number of incoming characters that have been lost because
+ * they weren't read quickly enough (since init_serial_stdio() was called).
+ */
+uint16_t serial_input_overruns(void);
+
+/* Return the number of characters that can be output without the output
+ * buffer filling up.
+ */
+uint16_t serial_output_space(void);
+
+/* Wait until length characters can be output without the output buffer
+ * filling up - e.g. before printing a line of a text screen, so the line
+ * can't be cut short when the output mode is SERIAL_OUTPUT_DROP. Returns
+ * at once if interrupts are disabled (the buffer would never be emptied)
+ * or if length is more than the buffer holds.
+ */
+void serial_wait_for_output_space(uint16_t length);
+
+/* Add length bytes of data to the output buffer if they all fit, without
+ * waiting. Returns length, or SERIAL_E_AGAIN (and nothing is added) if
+ * there isn't room - whatever the output mode. No \n to \r\n translation
+ * is done.
+ */
+int16_t serial_write(const char* data, uint16_t length);
+
+/* Return the number of characters thrown away because the output buffer
+ * was full, and the most characters that have been waiting in the buffer
+ * at once (both since init_serial_stdio() was called).
+ */
+uint16_t serial_output_dropped(void);
+uint16_t serial_output_high_water(void);
+
 #endif /* SERIALIO_H_ */
\ No newline at end of file
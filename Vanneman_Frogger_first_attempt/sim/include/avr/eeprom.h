@@ -0,0 +1,24 @@
+/*
+ * avr/eeprom.h (host simulation)
+ *
+ * The EEPROM is an array in sim_hw.c which can be loaded from and saved to
+ * a file (see sim_eeprom_file() in sim.h). Writes through these functions
+ * take no time. (Writes through the EEPROM registers, as an EEPROM ready
+ * interrupt handler does them, take as long as on the AVR - see sim_hw.c.)
+ */
+
+#ifndef SIM_AVR_EEPROM_H_
+#define SIM_AVR_EEPROM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/io.h>
+
+uint8_t eeprom_read_byte(const uint8_t* address);
+uint16_t eeprom_read_word(const uint16_t* address);
+void eeprom_read_block(void* destination, const void* source, size_t length);
+void eeprom_update_byte(uint8_t* address, uint8_t value);
+void eeprom_update_word(uint16_t* address, uint16_t value);
+void eeprom_update_block(const void* source, void* destination, size_t length);
+
+#endif /* SIM_AVR_EEPROM_H_ */
@@ -0,0 +1,22 @@
+/*
+ * avr/interrupt.h (host simulation)
+ *
+ * Interrupt handlers become ordinary functions which the simulation calls
+ * (see sim_hw.c). sei() and cli() set and clear the I bit in SREG as on
+ * the AVR. Turning interrupts off is also where the simulation lets time
+ * pass while the firmware is busy (see sim_cli()).
+ */
+
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) void vector(void)
+
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() sim_cli()
+
+void sim_cli(void);
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
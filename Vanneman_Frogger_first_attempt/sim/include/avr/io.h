@@ -0,0 +1,45 @@
+/*
+ * avr/io.h (host simulation)
+ *
+ * The registers used by the firmware, as plain variables (defined in
+ * sim_hw.c). Bit numbers are as on the ATmega324A.
+ */
+
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t PORTA, DDRA, PINA, PORTB, DDRB, PINB;
+extern volatile uint8_t PORTC, DDRC, PINC, PORTD, DDRD, PIND;
+extern volatile uint8_t SREG, SMCR, MCUSR;
+extern volatile uint8_t SPCR0, SPSR0, SPDR0;
+extern volatile uint8_t TCNT0, OCR0A, TCCR0A, TCCR0B, TIMSK0, TIFR0;
+extern volatile uint16_t TCNT1, OCR1A;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK3;
+extern volatile uint16_t UBRR0;
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern volatile uint8_t EECR, EEDR;
+extern volatile uint16_t EEAR;
+
+enum {
+	SREG_I = 7,
+	DDRA0 = 0, DDRA1, DDRA2, DDRA3,
+	SPR00 = 0, SPR10 = 1, MSTR0 = 4, SPE0 = 6, SPIE0 = 7,
+	SPI2X0 = 0, WCOL0 = 6, SPIF0 = 7,
+	WGM01 = 1, CS00 = 0, CS01 = 1, CS02 = 2, OCIE0A = 1, OCF0A = 1,
+	CS10 = 0, CS11 = 1, CS12 = 2, TOIE1 = 0,
+	PCIE1 = 1, PCIF1 = 1, PCINT8 = 0, PCINT9 = 1, PCINT10 = 2, PCINT11 = 3,
+	DOR0 = 3, FE0 = 4, RXC0 = 7, TXEN0 = 3, RXEN0 = 4, UDRIE0 = 5, RXCIE0 = 7,
+	EERE = 0, EEPE = 1, EEMPE = 2, EERIE = 3
+};
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(reg, bit) ((reg) & _BV(bit))
+#define bit_is_clear(reg, bit) (!((reg) & _BV(bit)))
+
+#define E2END 1023
+#define RAMEND 0x08FF
+
+#endif /* SIM_AVR_IO_H_ */
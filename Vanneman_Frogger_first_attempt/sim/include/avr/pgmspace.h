@@ -0,0 +1,34 @@
+/*
+ * avr/pgmspace.h (host simulation)
+ *
+ * There is only one address space on the host, so flash data is ordinary
+ * const data.
+ */
+
+#ifndef SIM_AVR_PGMSPACE_H_
+#define SIM_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define printf_P sim_printf_P
+#define sprintf_P sprintf
+#define snprintf_P sim_snprintf_P
+
+// printf() and snprintf() for formats written for avr-libc, where %S is a
+// string in flash and long is 32 bits (see sim_serial.c)
+int sim_printf_P(const char* format, ...);
+int sim_snprintf_P(char* buffer, size_t size, const char* format, ...);
+
+#endif /* SIM_AVR_PGMSPACE_H_ */
@@ -0,0 +1,17 @@
+/*
+ * avr/sleep.h (host simulation)
+ *
+ * Sleeping runs the simulation on to the next clock tick.
+ */
+
+#ifndef SIM_AVR_SLEEP_H_
+#define SIM_AVR_SLEEP_H_
+
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode) ((void)(mode))
+#define sleep_enable() ((void)0)
+#define sleep_disable() ((void)0)
+void sleep_cpu(void);
+
+#endif /* SIM_AVR_SLEEP_H_ */
@@ -0,0 +1,13 @@
+/*
+ * util/delay.h (host simulation)
+ *
+ * Delays run the simulation on by the given time.
+ */
+
+#ifndef SIM_UTIL_DELAY_H_
+#define SIM_UTIL_DELAY_H_
+
+void _delay_ms(double ms);
+#define _delay_us(us) ((void)(us))
+
+#endif /* SIM_UTIL_DELAY_H_ */
@@ -0,0 +1,57 @@
+/*
+ * sim.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Host simulation of the game. The firmware is built unchanged for the
+ * host, with stub AVR headers (include/) and stub SPI and serial backends
+ * which count the bytes the game would send. The simulated clock only
+ * moves on when the firmware sleeps, delays or has been busy for a while,
+ * so the game runs as fast as the host can go.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+
+// The firmware's interrupt handlers (see include/avr/interrupt.h)
+void TIMER0_COMPA_vect(void);
+void PCINT1_vect(void);
+void EE_READY_vect(void);
+
+// The firmware's main() (project.c is built with -Dmain=firmware_main)
+int firmware_main(void);
+
+// Milliseconds simulated so far
+extern uint32_t sim_time;
+
+// Run the simulation on by one millisecond (one timer tick), delivering
+// any scripted input that is due
+void sim_tick(void);
+
+// Called by sim_tick() - in sim_main.c
+void sim_script_tick(uint32_t now);
+
+// Press or release a button (0 to 3) - the pin change interrupt handler
+// is run straight away
+void sim_set_button(uint8_t button, uint8_t pressed);
+
+// Keep the EEPROM in the given file - it is loaded now (if the file
+// exists) and saved whenever the firmware writes to it. Otherwise the
+// EEPROM starts erased and isn't kept.
+void sim_eeprom_file(const char* filename);
+
+// SPI backend (sim_spi.c) - bytes queued for the LED matrix
+extern uint32_t sim_spi_bytes;
+
+// Serial backend (sim_serial.c). Received characters go into the input
+// buffer. sim_serial_tick() sends the bytes the UART would have sent in
+// the last millisecond.
+void sim_serial_receive(char c);
+void sim_serial_tick(void);
+void sim_serial_capture(const char* filename);
+extern uint32_t sim_uart_bytes;
+extern uint32_t sim_uart_dropped;
+
+#endif /* SIM_H_ */
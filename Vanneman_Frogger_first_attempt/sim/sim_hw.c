@@ -0,0 +1,192 @@
+/*
+ * sim_hw.c
+ *
+ * Author: Becca Vanneman
+ *
+ * Registers, EEPROM, interrupts and the simulated clock.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/delay.h>
+#include "sim.h"
+
+// Number of times the firmware can turn interrupts off without sleeping
+// before we count a millisecond as having passed. This stands in for the
+// CPU time spent by code that polls (e.g. waits for output buffer space)
+// rather than sleeping.
+#define SIM_BUSY_CALLS_PER_TICK 200
+
+// Time an EEPROM byte write takes (3.3ms on the AVR)
+#define SIM_EEPROM_WRITE_TICKS 4
+
+volatile uint8_t PORTA, DDRA, PINA, PORTB, DDRB, PINB;
+volatile uint8_t PORTC, DDRC, PINC, PORTD, DDRD, PIND;
+volatile uint8_t SREG, SMCR, MCUSR;
+volatile uint8_t SPCR0, SPSR0, SPDR0;
+volatile uint8_t TCNT0, OCR0A, TCCR0A, TCCR0B, TIMSK0, TIFR0;
+volatile uint16_t TCNT1, OCR1A;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK3;
+volatile uint16_t UBRR0;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+volatile uint8_t EECR, EEDR;
+volatile uint16_t EEAR;
+
+uint32_t sim_time;
+
+// EEPROM contents (erased to start with) and the file they are kept in
+static uint8_t eeprom[E2END + 1];
+static const char* eeprom_filename;
+static uint8_t eeprom_write_ticks;
+
+static void save_eeprom(void);
+static void eeprom_tick(void);
+
+static uint16_t busy_calls;
+static uint8_t in_interrupt;
+
+void sim_tick(void) {
+	// Interrupt handlers run with interrupts off, as on the AVR
+	uint8_t sreg = SREG;
+	in_interrupt = 1;
+	SREG &= ~_BV(SREG_I);
+	
+	busy_calls = 0;
+	sim_time++;
+	TIMER0_COMPA_vect();
+	eeprom_tick();
+	sim_serial_tick();
+	sim_script_tick(sim_time);
+	
+	SREG = sreg;
+	in_interrupt = 0;
+}
+
+void sim_set_button(uint8_t button, uint8_t pressed) {
+	if(pressed) {
+		PINB |= (1<<button);
+	} else {
+		PINB &= ~(1<<button);
+	}
+	if(PCICR & _BV(PCIE1)) {
+		PCINT1_vect();
+	}
+}
+
+void sim_cli(void) {
+	if((SREG & _BV(SREG_I)) && !in_interrupt &&
+			++busy_calls >= SIM_BUSY_CALLS_PER_TICK) {
+		// An interrupt arrives just before interrupts are turned off
+		sim_tick();
+	}
+	SREG &= ~_BV(SREG_I);
+}
+
+void sleep_cpu(void) {
+	// Sleep until the next timer interrupt
+	sim_tick();
+}
+
+void _delay_ms(double ms) {
+	for(uint32_t i = 0; i < (uint32_t)ms; i++) {
+		sim_tick();
+	}
+}
+
+void sim_eeprom_file(const char* filename) {
+	FILE* file = fopen(filename, "rb");
+	
+	eeprom_filename = filename;
+	memset(eeprom, 0xFF, sizeof(eeprom));
+	if(file) {
+		if(fread(eeprom, 1, sizeof(eeprom), file) == 0) {
+			memset(eeprom, 0xFF, sizeof(eeprom));
+		}
+		fclose(file);
+	}
+}
+
+// Carry on with a write started through the EEPROM registers (as the
+// EEPROM ready interrupt handler does) and run the handler while it is
+// enabled and the EEPROM is ready
+static void eeprom_tick(void) {
+	if(EECR & _BV(EEPE)) {
+		if(++eeprom_write_ticks < SIM_EEPROM_WRITE_TICKS) {
+			return;
+		}
+		eeprom_write_ticks = 0;
+		EECR &= ~(_BV(EEPE) | _BV(EEMPE));
+		if(EEAR <= E2END && eeprom[EEAR] != EEDR) {
+			eeprom[EEAR] = EEDR;
+			save_eeprom();
+		}
+	}
+	if(EECR & _BV(EERIE)) {
+		EE_READY_vect();
+	}
+}
+
+// Save the EEPROM to its file (if there is one) after a write
+static void save_eeprom(void) {
+	FILE* file;
+	
+	if(!eeprom_filename) {
+		return;
+	}
+	file = fopen(eeprom_filename, "wb");
+	if(!file) {
+		perror(eeprom_filename);
+		return;
+	}
+	fwrite(eeprom, 1, sizeof(eeprom), file);
+	fclose(file);
+}
+
+void eeprom_read_block(void* destination, const void* source, size_t length) {
+	uintptr_t address = (uintptr_t)source;
+	
+	memset(destination, 0xFF, length);
+	if(address <= E2END) {
+		memcpy(destination, &eeprom[address], 
+				length <= E2END + 1 - address ? length : E2END + 1 - address);
+	}
+}
+
+uint8_t eeprom_read_byte(const uint8_t* address) {
+	uint8_t value;
+	eeprom_read_block(&value, address, 1);
+	return value;
+}
+
+uint16_t eeprom_read_word(const uint16_t* address) {
+	uint16_t value;
+	eeprom_read_block(&value, address, 2);
+	return value;
+}
+
+void eeprom_update_block(const void* source, void* destination, size_t length) {
+	uintptr_t address = (uintptr_t)destination;
+	
+	if(address > E2END || length > E2END + 1 - address) {
+		fprintf(stderr, "EEPROM write past the end (%lu bytes at 0x%lx)\n",
+				(unsigned long)length, (unsigned long)address);
+		return;
+	}
+	if(memcmp(&eeprom[address], source, length) != 0) {
+		memcpy(&eeprom[address], source, length);
+		save_eeprom();
+	}
+}
+
+void eeprom_update_byte(uint8_t* address, uint8_t value) {
+	eeprom_update_block(&value, address, 1);
+}
+
+void eeprom_update_word(uint16_t* address, uint16_t value) {
+	eeprom_update_block(&value, address, 2);
+}
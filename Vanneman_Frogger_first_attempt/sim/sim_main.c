@@ -0,0 +1,208 @@
+/*
+ * sim_main.c
+ *
+ * Author: Becca Vanneman
+ *
+ * Headless benchmark harness. Runs the game for a given simulated time,
+ * replaying scripted input, and reports the bytes the game sent over SPI
+ * (to the LED matrix) and the UART, per clock tick, and how many
+ * simulated ticks per second the host managed.
+ *
+ * Usage: frogger_sim [-t ms] [-o terminal_output] [-e eeprom_file] script
+ *
+ * Each line of the script is
+ *     <time> <input>
+ * or
+ *     <time> every <period> <input>
+ * where times are in ms, and <input> is B0 to B3 (push and release a
+ * button) or characters typed on the serial terminal (e.g. U, or
+ * LLUR - sent 1ms apart). "every" repeats the input from that time on.
+ * Lines starting with # are comments.
+ * The EEPROM can be kept in a file (-e) - e.g. to replay a game whose
+ * input log was saved on the board (read the EEPROM with avrdude -U
+ * eeprom:r:file:r) by typing ! at the start.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "score.h"
+#include "game.h"
+
+#define DEFAULT_RUN_TIME 60000
+#define MAX_SCRIPT_EVENTS 256
+#define MAX_INPUT_LENGTH 16
+
+// How long a scripted button push holds the button down (ms). Longer
+// than the debounce time but shorter than the auto repeat delay.
+#define BUTTON_HOLD_TIME 50
+
+typedef struct {
+	uint32_t time;		// next time this input is due
+	uint32_t period;	// 0 if it only happens once
+	char input[MAX_INPUT_LENGTH + 1];
+} ScriptEvent;
+
+static ScriptEvent events[MAX_SCRIPT_EVENTS];
+static uint16_t num_events;
+
+// Button releases and serial characters still to come from the input
+// being replayed
+static int8_t held_button = -1;
+static uint32_t button_release_time;
+static const char* typing;
+
+static uint32_t run_time = DEFAULT_RUN_TIME;
+static struct timespec start_time;
+
+// Bytes sent during the busiest tick
+static uint32_t last_spi_bytes, last_uart_bytes;
+static uint32_t max_spi_per_tick, max_uart_per_tick;
+
+static void load_script(const char* filename);
+static void start_input(const char* input);
+static void finish(void);
+
+int main(int argc, char** argv) {
+	int opt;
+	while((opt = getopt(argc, argv, "t:o:e:")) != -1) {
+		switch(opt) {
+			case 't':
+				run_time = strtoul(optarg, NULL, 10);
+				break;
+			case 'o':
+				sim_serial_capture(optarg);
+				break;
+			case 'e':
+				sim_eeprom_file(optarg);
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-t ms] [-o terminal_output] [-e eeprom_file] script\n", argv[0]);
+				return 1;
+		}
+	}
+	if(optind != argc - 1) {
+		fprintf(stderr, "Usage: %s [-t ms] [-o terminal_output] [-e eeprom_file] script\n", argv[0]);
+		return 1;
+	}
+	load_script(argv[optind]);
+	
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	firmware_main();
+	return 0;
+}
+
+void sim_script_tick(uint32_t now) {
+	// Busiest tick so far
+	if(sim_spi_bytes - last_spi_bytes > max_spi_per_tick) {
+		max_spi_per_tick = sim_spi_bytes - last_spi_bytes;
+	}
+	if(sim_uart_bytes - last_uart_bytes > max_uart_per_tick) {
+		max_uart_per_tick = sim_uart_bytes - last_uart_bytes;
+	}
+	last_spi_bytes = sim_spi_bytes;
+	last_uart_bytes = sim_uart_bytes;
+	
+	if(now >= run_time) {
+		finish();
+	}
+	
+	// Carry on with the input already started
+	if(held_button >= 0 && now >= button_release_time) {
+		sim_set_button(held_button, 0);
+		held_button = -1;
+	}
+	if(typing && *typing) {
+		sim_serial_receive(*typing++);
+	}
+	
+	// Start any input that is due (one at a time)
+	if(held_button >= 0 || (typing && *typing)) {
+		return;
+	}
+	for(uint16_t i = 0; i < num_events; i++) {
+		if(events[i].time <= now) {
+			start_input(events[i].input);
+			if(events[i].period) {
+				events[i].time += events[i].period;
+			} else {
+				events[i].time = UINT32_MAX;
+			}
+			return;
+		}
+	}
+}
+
+static void load_script(const char* filename) {
+	char line[128];
+	FILE* script = fopen(filename, "r");
+	if(!script) {
+		perror(filename);
+		exit(1);
+	}
+	while(fgets(line, sizeof(line), script)) {
+		ScriptEvent* event = &events[num_events];
+		char first[MAX_INPUT_LENGTH + 1], second[MAX_INPUT_LENGTH + 1];
+		unsigned long time, period;
+		if(line[0] == '#' || sscanf(line, "%lu %16s", &time, first) != 2) {
+			continue;
+		}
+		if(num_events >= MAX_SCRIPT_EVENTS) {
+			fprintf(stderr, "%s: too many lines\n", filename);
+			exit(1);
+		}
+		event->time = time;
+		event->period = 0;
+		if(strcmp(first, "every") == 0) {
+			if(sscanf(line, "%*s every %lu %16s", &period, second) != 2 || period == 0) {
+				fprintf(stderr, "%s: bad line: %s", filename, line);
+				exit(1);
+			}
+			event->period = period;
+			strcpy(event->input, second);
+		} else {
+			strcpy(event->input, first);
+		}
+		num_events++;
+	}
+	fclose(script);
+}
+
+static void start_input(const char* input) {
+	if(input[0] == 'B' && input[1] >= '0' && input[1] <= '3' && input[2] == '\0') {
+		held_button = input[1] - '0';
+		button_release_time = sim_time + BUTTON_HOLD_TIME;
+		sim_set_button(held_button, 1);
+	} else {
+		typing = input;
+	}
+}
+
+static void finish(void) {
+	struct timespec end_time;
+	double seconds;
+	
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+	seconds = (end_time.tv_sec - start_time.tv_sec) + 
+			(end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+	if(seconds <= 0) {
+		seconds = 1e-9;
+	}
+	
+	fprintf(stderr, "simulated ticks:    %lu (%.1f s)\n", (unsigned long)sim_time,
+			sim_time / 1000.0);
+	fprintf(stderr, "host time:          %.3f s (%.0f ticks/s, %.0fx real time)\n",
+			seconds, sim_time / seconds, sim_time / 1000.0 / seconds);
+	fprintf(stderr, "SPI bytes:          %lu (%.3f per tick, at most %lu in a tick)\n",
+			(unsigned long)sim_spi_bytes, (double)sim_spi_bytes / sim_time,
+			(unsigned long)max_spi_per_tick);
+	fprintf(stderr, "UART bytes:         %lu (%.3f per tick, at most %lu in a tick, %lu dropped)\n",
+			(unsigned long)sim_uart_bytes, (double)sim_uart_bytes / sim_time,
+			(unsigned long)max_uart_per_tick, (unsigned long)sim_uart_dropped);
+	fprintf(stderr, "score:              %lu (%u lives left)\n",
+			(unsigned long)get_score(), num_frog_lives());
+	exit(0);
+}
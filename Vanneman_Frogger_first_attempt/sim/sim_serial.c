@@ -0,0 +1,235 @@
+/*
+ * sim_serial.c
+ *
+ * Author: Becca Vanneman
+ *
+ * Serial backend for the host simulation, with the same buffering as
+ * serialio.c. Output (through stdout or serial_write()) goes into a
+ * buffer which is emptied at the baud rate as the simulated clock ticks,
+ * so the game sees the same lack of output space as it would on the AVR.
+ * Sent bytes are counted and can be saved to a file (e.g. to look at the
+ * terminal display afterwards).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "serialio.h"
+#include "sim.h"
+
+#ifdef SERIAL_OUTPUT_BUFFER_SIZE
+#define OUTPUT_BUFFER_SIZE SERIAL_OUTPUT_BUFFER_SIZE
+#else
+#define OUTPUT_BUFFER_SIZE 255
+#endif
+#ifdef SERIAL_INPUT_BUFFER_SIZE
+#define INPUT_BUFFER_SIZE SERIAL_INPUT_BUFFER_SIZE
+#else
+#define INPUT_BUFFER_SIZE 64
+#endif
+
+uint32_t sim_uart_bytes;
+uint32_t sim_uart_dropped;
+
+static long baud;
+static uint8_t out_mode;
+static uint16_t bytes_in_out_buffer;
+static uint16_t out_high_water;
+static uint32_t send_credit;	// in 1/10000ths of a byte
+static FILE* capture;
+
+static char input_buffer[INPUT_BUFFER_SIZE];
+static uint8_t input_insert_pos;
+static uint8_t bytes_in_input_buffer;
+static uint16_t input_overruns;
+
+// Longest printf_P() format we translate
+#define MAX_FORMAT_LENGTH 128
+
+static uint8_t put_byte(char c);
+static ssize_t write_stdout(void* cookie, const char* data, size_t length);
+
+void init_serial_stdio(long baudrate, int8_t echo, uint8_t output_mode) {
+	cookie_io_functions_t functions = { .write = write_stdout };
+	(void)echo;
+	baud = baudrate;
+	out_mode = output_mode;
+	bytes_in_out_buffer = 0;
+	
+	// printf() etc. go to the UART
+	stdout = fopencookie(NULL, "w", functions);
+	setvbuf(stdout, NULL, _IONBF, 0);
+}
+
+int8_t serial_input_available(void) {
+	return bytes_in_input_buffer != 0;
+}
+
+void clear_serial_input_buffer(void) {
+	bytes_in_input_buffer = 0;
+}
+
+uint8_t serial_read(char* buffer, uint8_t max_length) {
+	uint8_t count = 0;
+	while(count < max_length && bytes_in_input_buffer > 0) {
+		buffer[count++] = input_buffer[(input_insert_pos - bytes_in_input_buffer + 
+				INPUT_BUFFER_SIZE) % INPUT_BUFFER_SIZE];
+		bytes_in_input_buffer--;
+	}
+	return count;
+}
+
+uint16_t serial_input_overruns(void) {
+	return input_overruns;
+}
+
+uint16_t serial_output_space(void) {
+	// Interrupts are turned off around the check, as in serialio.c, so
+	// time passes in loops that wait for space
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	uint16_t space;
+	cli();
+	space = OUTPUT_BUFFER_SIZE - bytes_in_out_buffer;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return space;
+}
+
+void serial_wait_for_output_space(uint16_t length) {
+	if(length > OUTPUT_BUFFER_SIZE || !bit_is_set(SREG, SREG_I)) {
+		return;
+	}
+	while(serial_output_space() < length) {
+		; // time passes each time round (see above)
+	}
+}
+
+int16_t serial_write(const char* data, uint16_t length) {
+	if(length > serial_output_space()) {
+		return SERIAL_E_AGAIN;
+	}
+	for(uint16_t i = 0; i < length; i++) {
+		put_byte(data[i]);
+	}
+	return length;
+}
+
+uint16_t serial_output_dropped(void) {
+	return sim_uart_dropped;
+}
+
+uint16_t serial_output_high_water(void) {
+	return out_high_water;
+}
+
+void sim_serial_receive(char c) {
+	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
+		input_overruns++;
+		return;
+	}
+	input_buffer[input_insert_pos] = c;
+	input_insert_pos = (input_insert_pos + 1) % INPUT_BUFFER_SIZE;
+	bytes_in_input_buffer++;
+}
+
+void sim_serial_tick(void) {
+	// Each byte is 10 bits (start, 8 data bits, stop)
+	send_credit += baud;
+	while(send_credit >= 10000) {
+		send_credit -= 10000;
+		if(bytes_in_out_buffer > 0) {
+			bytes_in_out_buffer--;
+		}
+	}
+	if(bytes_in_out_buffer == 0) {
+		// Idle UART - no saving up to send faster later
+		send_credit = 0;
+	}
+}
+
+void sim_serial_capture(const char* filename) {
+	capture = fopen(filename, "wb");
+}
+
+// Add a byte to the output buffer. Returns 0 if it was dropped.
+static uint8_t put_byte(char c) {
+	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+		if(out_mode == SERIAL_OUTPUT_BLOCK && bit_is_set(SREG, SREG_I)) {
+			// Wait for the UART to send something
+			sim_tick();
+		} else {
+			sim_uart_dropped++;
+			return 0;
+		}
+	}
+	bytes_in_out_buffer++;
+	if(bytes_in_out_buffer > out_high_water) {
+		out_high_water = bytes_in_out_buffer;
+	}
+	sim_uart_bytes++;
+	if(capture) {
+		fputc(c, capture);
+	}
+	return 1;
+}
+
+static ssize_t write_stdout(void* cookie, const char* data, size_t length) {
+	(void)cookie;
+	for(size_t i = 0; i < length; i++) {
+		put_byte(data[i]);
+	}
+	return length;
+}
+
+// Turn a format written for avr-libc into one for the host's printf().
+// %S (a string in flash) becomes %s, and l is dropped from conversions
+// because a long on the AVR is the size of an int on the host.
+static void translate_format(char* host_format, size_t size, const char* format) {
+	uint8_t in_conversion = 0;
+	size_t length = 0;
+	
+	for(; *format && length < size - 1; format++) {
+		if(!in_conversion) {
+			in_conversion = (*format == '%');
+		} else if(*format == 'l') {
+			continue;
+		} else if(*format == 'S') {
+			host_format[length++] = 's';
+			in_conversion = 0;
+			continue;
+		} else if(strchr("csdiouxXp%", *format)) {
+			in_conversion = 0;
+		}
+		host_format[length++] = *format;
+	}
+	host_format[length] = '\0';
+}
+
+int sim_printf_P(const char* format, ...) {
+	char host_format[MAX_FORMAT_LENGTH];
+	va_list args;
+	int result;
+	
+	translate_format(host_format, sizeof(host_format), format);
+	va_start(args, format);
+	result = vprintf(host_format, args);
+	va_end(args);
+	return result;
+}
+
+int sim_snprintf_P(char* buffer, size_t size, const char* format, ...) {
+	char host_format[MAX_FORMAT_LENGTH];
+	va_list args;
+	int result;
+	
+	translate_format(host_format, sizeof(host_format), format);
+	va_start(args, format);
+	result = vsnprintf(buffer, size, host_format, args);
+	va_end(args);
+	return result;
+}
@@ -0,0 +1,39 @@
+/*
+ * sim_spi.c
+ *
+ * Author: Becca Vanneman
+ *
+ * SPI backend for the host simulation. Nothing is sent - we just count
+ * the bytes the LED matrix would have been sent.
+ */
+
+#include <stdint.h>
+#include "spi.h"
+#include "sim.h"
+
+uint32_t sim_spi_bytes;
+
+void spi_setup_master(uint8_t clockdivider) {
+	(void)clockdivider;
+}
+
+uint8_t spi_send_byte(uint8_t byte) {
+	(void)byte;
+	sim_spi_bytes++;
+	return 0;
+}
+
+void spi_queue_byte(uint8_t byte) {
+	(void)byte;
+	sim_spi_bytes++;
+}
+
+void spi_flush(void) {
+}
+
+void spi_set_rate_limit(uint8_t bytes_per_millisecond) {
+	(void)bytes_per_millisecond;
+}
+
+void spi_rate_limit_tick(void) {
+}
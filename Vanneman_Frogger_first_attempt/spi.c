@@ -5,7 +5,34 @@
  */ 
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "spi.h"
+#include "profiler.h"
+
+// Circular buffer of bytes waiting to be sent. queue_head is the position
+// the next queued byte is written to (only changed by spi_queue_byte()) and
+// queue_tail is the position of the next byte to be sent (only changed when
+// a transfer completes). The queue is empty when they are equal, so it can
+// hold SPI_QUEUE_SIZE-1 bytes.
+// transfer_in_progress is 1 while a byte is being shifted out - the next
+// byte (if any) is then sent when the SPI transfer complete interrupt fires.
+#define SPI_QUEUE_SIZE 64	// must be power of 2
+static volatile uint8_t spi_queue[SPI_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+static volatile uint8_t transfer_in_progress;
+
+// Rate limiting. bytes_per_ms is the number of bytes we may send each
+// millisecond (0 if unlimited) and byte_budget is how many we may still send
+// in the current millisecond. If we run out of budget we set stalled (but
+// leave transfer_in_progress set so new bytes are queued behind the waiting
+// ones) until spi_rate_limit_tick() starts sending again.
+static volatile uint8_t bytes_per_ms;
+static volatile uint8_t byte_budget;
+static volatile uint8_t stalled;
+
+static void send_next_queued_byte(void);
+static void wait_for_transfer_by_polling(void);
 
 void spi_setup_master(uint8_t clockdivider) {
 	// Set up SPI communication as a master
@@ -20,7 +47,14 @@ void spi_setup_master(uint8_t clockdivider) {
 	// Set up the SPI control registers SPCR and SPSR:
 	// - SPE bit = 1 (SPI is enabled)
 	// - MSTR bit = 1 (Master Mode)
-	SPCR0 = (1<<SPE0)|(1<<MSTR0);
+	// - SPIE bit = 1 (Interrupt when each transfer is complete)
+	SPCR0 = (1<<SPE0)|(1<<MSTR0)|(1<<SPIE0);
+	
+	// Empty the transmit queue
+	queue_head = queue_tail = 0;
+	transfer_in_progress = 0;
+	stalled = 0;
+	byte_budget = bytes_per_ms;
 	
 	// Set SPR0 and SPR1 bits in SPCR and SPI2X bit in SPSR
 	// based on the given clock divider
@@ -55,6 +89,12 @@ void spi_setup_master(uint8_t clockdivider) {
 }
 
 uint8_t spi_send_byte(uint8_t byte) {
+	// Send anything still queued first, then turn off the transfer
+	// complete interrupt while we wait for this byte so that the
+	// interrupt handler doesn't clear the SPIF0 bit before we see it.
+	spi_flush();
+	SPCR0 &= ~(1<<SPIE0);
+	
 	// Write out the byte to the SPDR0 register. This will initiate
 	// the transfer. We then wait until the most significant byte of
 	// SPSR0 (SPIF0 bit) is set - this indicates that the transfer is
@@ -65,5 +105,118 @@ uint8_t spi_send_byte(uint8_t byte) {
 	while((SPSR0 & (1<<SPIF0)) == 0) {
 		; // wait
 	}
-	return SPDR0;
+	uint8_t received = SPDR0;
+	SPCR0 |= (1<<SPIE0);
+	return received;
+}
+
+void spi_queue_byte(uint8_t byte) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	uint8_t next_head = (queue_head + 1) & (SPI_QUEUE_SIZE - 1);
+	
+	// Wait until there is space in the queue. queue_tail is changed by the
+	// interrupt handler below (or by us if interrupts are off).
+	if(next_head == queue_tail) {
+		PROFILE_BEGIN(PROFILE_SPI_STALL);
+		while(next_head == queue_tail) {
+			if(!interrupts_enabled) {
+				wait_for_transfer_by_polling();
+			}
+		}
+		PROFILE_END(PROFILE_SPI_STALL);
+	}
+	
+	// If the bus is idle we can start sending this byte straight away,
+	// otherwise it goes on the end of the queue. We turn interrupts off
+	// so the interrupt handler can't finish the current transfer between
+	// us checking and updating the queue.
+	cli();
+	if(transfer_in_progress) {
+		spi_queue[queue_head] = byte;
+		queue_head = next_head;
+	} else if(bytes_per_ms && byte_budget == 0) {
+		// Bus is idle but we've used up this millisecond's budget
+		spi_queue[queue_head] = byte;
+		queue_head = next_head;
+		transfer_in_progress = 1;
+		stalled = 1;
+	} else {
+		transfer_in_progress = 1;
+		byte_budget--;
+		SPDR0 = byte;
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+void spi_flush(void) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	while(transfer_in_progress) {
+		if(!interrupts_enabled) {
+			wait_for_transfer_by_polling();
+		}
+	}
+}
+
+// Start sending the next byte in the queue (if any). Must be called
+// with interrupts off when a transfer has just completed.
+static void send_next_queued_byte(void) {
+	if(queue_tail != queue_head) {
+		if(bytes_per_ms && byte_budget == 0) {
+			stalled = 1;
+			return;
+		}
+		byte_budget--;
+		SPDR0 = spi_queue[queue_tail];
+		queue_tail = (queue_tail + 1) & (SPI_QUEUE_SIZE - 1);
+	} else {
+		transfer_in_progress = 0;
+	}
+}
+
+// Used when interrupts are disabled - wait for the current transfer to
+// complete and then do what the interrupt handler would have done.
+static void wait_for_transfer_by_polling(void) {
+	if(stalled) {
+		// We can't wait for the timer interrupt - ignore the rate limit
+		stalled = 0;
+		byte_budget = bytes_per_ms;
+		send_next_queued_byte();
+		return;
+	}
+	while((SPSR0 & (1<<SPIF0)) == 0) {
+		; // wait
+	}
+	(void)SPDR0;	// clears SPIF0
+	send_next_queued_byte();
+}
+
+void spi_set_rate_limit(uint8_t bytes_per_millisecond) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	bytes_per_ms = bytes_per_millisecond;
+	byte_budget = bytes_per_millisecond;
+	if(stalled) {
+		stalled = 0;
+		send_next_queued_byte();
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+// Called from the timer interrupt handler every millisecond
+void spi_rate_limit_tick(void) {
+	byte_budget = bytes_per_ms;
+	if(stalled) {
+		stalled = 0;
+		send_next_queued_byte();
+	}
+}
+
+// Interrupt handler for SPI transfer complete. (The SPIF0 bit is cleared
+// by hardware when this handler is executed.)
+ISR(SPI_STC_vect) {
+	send_next_queued_byte();
 }
\ No newline at end of file
@@ -12,7 +12,30 @@
 void spi_setup_master(uint8_t clockdivider);
 
 // Send and receive an SPI byte. This function will take at least 8 
-// cyles of the divided clock (i.e. will busy wait).
+// cyles of the divided clock (i.e. will busy wait). Any queued bytes
+// (see below) are sent first.
 uint8_t spi_send_byte(uint8_t byte);
 
+// Queue a byte to be sent over SPI and return immediately. Queued bytes
+// are sent in order by the SPI interrupt handler as the bus becomes free
+// (any byte received in return is discarded). If the queue is full we
+// wait until there is space. Interrupts should be enabled globally for
+// the queue to drain - if they are not, we poll the SPI hardware instead
+// of waiting for an interrupt that will never come.
+void spi_queue_byte(uint8_t byte);
+
+// Wait until all queued bytes have been sent. Use this where something
+// else must not happen until the LED matrix has received everything.
+void spi_flush(void);
+
+// Limit the number of queued bytes sent each millisecond (0 means no
+// limit). This lets a fast clock divider be used with a device that can't
+// keep up with a continuous stream of bytes at that speed - bytes are sent
+// in short bursts at the full clock rate with gaps in between.
+// spi_rate_limit_tick() must be called every millisecond (from the timer
+// interrupt handler) to start the next burst. (If interrupts are disabled
+// when we have to poll, the limit is not enforced.)
+void spi_set_rate_limit(uint8_t bytes_per_millisecond);
+void spi_rate_limit_tick(void);
+
 #endif /* SPI_H_ */
\ No newline at end of file
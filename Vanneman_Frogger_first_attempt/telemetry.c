@@ -0,0 +1,134 @@
+/*
+ * telemetry.c
+ *
+ * Author: Becca Vanneman
+ */
+
+#include <util/crc16.h>
+#include "telemetry.h"
+#include "serialio.h"
+
+// Longest record (type, largest payload (TELEMETRY_LANES) and CRC). COBS
+// adds one byte (for records this short) and then there is the zero byte
+// at the end.
+#define MAX_PAYLOAD_LENGTH (2 * TELEMETRY_NUM_LANES)
+#define MAX_RECORD_LENGTH (1 + MAX_PAYLOAD_LENGTH + 2)
+#define MAX_FRAME_LENGTH (MAX_RECORD_LENGTH + 2)
+
+static uint8_t enabled;
+static uint16_t frames_dropped;
+
+// Record being built. record_length is the number of bytes used so far
+static uint8_t record[MAX_RECORD_LENGTH];
+static uint8_t record_length;
+
+static void start_record(uint8_t type);
+static void add_byte(uint8_t value);
+static void add_uint16(uint16_t value);
+static void add_uint32(uint32_t value);
+static uint8_t send_record(void);
+
+void telemetry_enable(uint8_t enable) {
+	enabled = enable;
+}
+
+uint8_t telemetry_enabled(void) {
+	return enabled;
+}
+
+uint8_t telemetry_send_tick(uint32_t time) {
+	start_record(TELEMETRY_TICK);
+	add_uint32(time);
+	return send_record();
+}
+
+uint8_t telemetry_send_frog(uint8_t row, uint8_t column, uint8_t lives) {
+	start_record(TELEMETRY_FROG);
+	add_byte(row);
+	add_byte(column);
+	add_byte(lives);
+	return send_record();
+}
+
+uint8_t telemetry_send_lanes(const uint16_t positions[TELEMETRY_NUM_LANES]) {
+	start_record(TELEMETRY_LANES);
+	for(uint8_t i = 0; i < TELEMETRY_NUM_LANES; i++) {
+		add_uint16(positions[i]);
+	}
+	return send_record();
+}
+
+uint8_t telemetry_send_score(uint16_t points_added, uint32_t score) {
+	start_record(TELEMETRY_SCORE);
+	add_uint16(points_added);
+	add_uint32(score);
+	return send_record();
+}
+
+uint8_t telemetry_send_loop_timing(uint16_t iterations, uint16_t longest) {
+	start_record(TELEMETRY_LOOP_TIMING);
+	add_uint16(iterations);
+	add_uint16(longest);
+	return send_record();
+}
+
+uint16_t telemetry_frames_dropped(void) {
+	return frames_dropped;
+}
+
+static void start_record(uint8_t type) {
+	record[0] = type;
+	record_length = 1;
+}
+
+static void add_byte(uint8_t value) {
+	record[record_length++] = value;
+}
+
+static void add_uint16(uint16_t value) {
+	add_byte(value & 0xFF);
+	add_byte(value >> 8);
+}
+
+static void add_uint32(uint32_t value) {
+	add_uint16(value & 0xFFFF);
+	add_uint16(value >> 16);
+}
+
+// Add the CRC, COBS encode the record and send it (if there is room).
+// COBS replaces each zero byte with the distance to the next zero byte
+// (and there is an extra one at the start giving the distance to the
+// first). The distances can't be more than 254 - our records are much
+// shorter than this so we don't handle that case.
+static uint8_t send_record(void) {
+	uint8_t frame[MAX_FRAME_LENGTH];
+	uint8_t code_pos, frame_length;
+	uint16_t crc = 0xFFFF;
+	
+	if(!enabled) {
+		return 0;
+	}
+	for(uint8_t i = 0; i < record_length; i++) {
+		crc = _crc_ccitt_update(crc, record[i]);
+	}
+	add_uint16(crc);
+	
+	code_pos = 0;
+	frame_length = 1;
+	for(uint8_t i = 0; i < record_length; i++) {
+		if(record[i] == 0) {
+			frame[code_pos] = frame_length - code_pos;
+			code_pos = frame_length++;
+		} else {
+			frame[frame_length++] = record[i];
+		}
+	}
+	frame[code_pos] = frame_length - code_pos;
+	frame[frame_length++] = 0;
+	
+	if(serial_write((const char*)frame, frame_length) == SERIAL_E_AGAIN) {
+		frames_dropped++;
+		return 0;
+	}
+	return 1;
+}
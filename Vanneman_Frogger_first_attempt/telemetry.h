@@ -0,0 +1,51 @@
+/*
+ * telemetry.h
+ *
+ * Author: Becca Vanneman
+ *
+ * Compact binary telemetry sent over the serial port for a host program to
+ * log or graph (instead of the human readable terminal display). Each
+ * record is a type byte followed by a fixed size payload (multi-byte
+ * values are little endian) and a CRC-CCITT (initial value 0xFFFF) of the
+ * type and payload, low byte first. The record is COBS encoded so that
+ * it contains no zero bytes and then sent followed by a zero byte, which
+ * marks the end of the frame. A host that starts listening part way
+ * through a frame just waits for the next zero byte.
+ *
+ * Frames are only sent if they fit in the serial output buffer - if there
+ * isn't room the frame is dropped (and counted) rather than waiting.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+// Record types and their payloads
+#define TELEMETRY_TICK			1	// uint32 time (ms)
+#define TELEMETRY_FROG			2	// uint8 row, uint8 column, uint8 lives
+#define TELEMETRY_LANES			3	// uint16 position of each lane (see below)
+#define TELEMETRY_SCORE			4	// uint16 points added, uint32 new score
+#define TELEMETRY_LOOP_TIMING	5	// uint16 loop iterations, uint16 longest (ms)
+
+// Number of positions in a TELEMETRY_LANES record - the 3 traffic lanes
+// then the 2 river channels
+#define TELEMETRY_NUM_LANES 5
+
+// Turn telemetry on or off. It starts off. While it is off the functions
+// below send nothing.
+void telemetry_enable(uint8_t enable);
+uint8_t telemetry_enabled(void);
+
+// Send a record. Each returns 1 if the frame was sent, 0 if not (because
+// telemetry is off or there wasn't room in the serial output buffer).
+uint8_t telemetry_send_tick(uint32_t time);
+uint8_t telemetry_send_frog(uint8_t row, uint8_t column, uint8_t lives);
+uint8_t telemetry_send_lanes(const uint16_t positions[TELEMETRY_NUM_LANES]);
+uint8_t telemetry_send_score(uint16_t points_added, uint32_t score);
+uint8_t telemetry_send_loop_timing(uint16_t iterations, uint16_t longest);
+
+// Return the number of frames dropped because there wasn't room for them.
+uint16_t telemetry_frames_dropped(void);
+
+#endif /* TELEMETRY_H_ */
@@ -6,10 +6,46 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <avr/pgmspace.h>
 
 #include "terminalio.h"
+#include "serialio.h"
+#include "timer0.h"
+
+/* HUD layout - field n is on row HUD_Y + n. Values start after the label. */
+#define HUD_X 30
+#define HUD_Y 2
+#define HUD_VALUE_X (HUD_X + 7)
+#define HUD_MAX_DIGITS 10
+
+/* Worst case length of the cursor movement and clear to end of line
+ * escape sequences. (We don't know exactly how many bytes move_cursor()
+ * sends so charge the worst case to the budget.)
+ */
+#define CURSOR_MOVE_BYTES 8
+#define CLEAR_TO_EOL_BYTES 3
+
+static const char score_label[] PROGMEM = "Score: ";
+static const char level_label[] PROGMEM = "Level: ";
+static const char lives_label[] PROGMEM = "Lives: ";
+static const char countdown_label[] PROGMEM = "Time:  ";
+static PGM_P const hud_labels[HUD_NUM_FIELDS] = {
+	score_label, level_label, lives_label, countdown_label
+};
+
+static uint32_t hud_values[HUD_NUM_FIELDS];
+/* The digits on the screen for each field (empty if none) */
+static char hud_shown[HUD_NUM_FIELDS][HUD_MAX_DIGITS + 1];
+/* Bit n is set if field n has a value that hasn't been sent / has its
+ * label on the screen
+ */
+static uint8_t hud_changed;
+static uint8_t hud_labels_shown;
+static uint32_t hud_next_frame;
+
+static uint8_t hud_format_number(uint32_t value, char* text);
 
 void move_cursor(int x, int y) {
     printf_P(PSTR("\x1b[%d;%dH"), y, x);
@@ -84,3 +120,108 @@ void draw_vertical_line(int8_t x, int8_t start_y, int8_t end_y) {
 	printf(" ");
 	normal_display_mode();
 }
+
+void hud_init(uint32_t current_time) {
+	for(uint8_t field = 0; field < HUD_NUM_FIELDS; field++) {
+		hud_shown[field][0] = 0;
+	}
+	hud_changed = (1<<HUD_NUM_FIELDS) - 1;
+	hud_labels_shown = 0;
+	hud_next_frame = current_time;
+}
+
+void hud_set_field(HudField field, uint32_t value) {
+	if(value != hud_values[field]) {
+		hud_values[field] = value;
+		hud_changed |= (1<<field);
+	}
+}
+
+void hud_update(uint32_t current_time) {
+	char text[HUD_MAX_DIGITS + 1];
+	uint8_t length, first_change, shown_length;
+	int16_t budget, cost;
+	uint16_t space;
+	
+	if(hud_changed == 0 || time_before(current_time, hud_next_frame)) {
+		return;
+	}
+	hud_next_frame = current_time + HUD_FRAME_PERIOD;
+	
+	/* Never send more than the serial output buffer has room for - a
+	 * change that doesn't fit stays marked as changed, so if the field
+	 * changes again before it is sent only the latest value goes out.
+	 */
+	space = serial_output_space();
+	budget = (space < HUD_BYTES_PER_FRAME) ? space : HUD_BYTES_PER_FRAME;
+	
+	for(uint8_t field = 0; field < HUD_NUM_FIELDS; field++) {
+		if(!(hud_changed & (1<<field))) {
+			continue;
+		}
+		/* Work out which digits differ from those on the screen */
+		length = hud_format_number(hud_values[field], text);
+		shown_length = strlen(hud_shown[field]);
+		first_change = 0;
+		while(first_change < length && 
+				text[first_change] == hud_shown[field][first_change]) {
+			first_change++;
+		}
+		
+		if(hud_labels_shown & (1<<field)) {
+			if(first_change == length && shown_length == length) {
+				/* Changed back to what is shown - nothing to send */
+				hud_changed &= ~(1<<field);
+				continue;
+			}
+			cost = CURSOR_MOVE_BYTES + (length - first_change);
+			if(shown_length > length) {
+				cost += CLEAR_TO_EOL_BYTES;
+			}
+			if(cost > budget) {
+				/* Doesn't fit in this frame - try the next field */
+				continue;
+			}
+			move_cursor(HUD_VALUE_X + first_change, HUD_Y + field);
+			budget -= CURSOR_MOVE_BYTES;
+		} else {
+			/* Draw the whole line including the label */
+			first_change = 0;
+			cost = CURSOR_MOVE_BYTES + strlen_P(hud_labels[field]) +
+					length + CLEAR_TO_EOL_BYTES;
+			if(cost > budget) {
+				continue;
+			}
+			move_cursor(HUD_X, HUD_Y + field);
+			budget -= CURSOR_MOVE_BYTES;
+			budget -= printf_P(hud_labels[field]);
+			shown_length = HUD_MAX_DIGITS + 1; /* force clearing */
+			hud_labels_shown |= (1<<field);
+		}
+		budget -= printf_P(PSTR("%s"), &text[first_change]);
+		if(shown_length > length) {
+			clear_to_end_of_line();
+			budget -= CLEAR_TO_EOL_BYTES;
+		}
+		strcpy(hud_shown[field], text);
+		hud_changed &= ~(1<<field);
+	}
+}
+
+/* Write value as decimal digits (null terminated) and return the number
+ * of digits.
+ */
+static uint8_t hud_format_number(uint32_t value, char* text) {
+	char digits[HUD_MAX_DIGITS];
+	uint8_t num_digits = 0;
+	
+	do {
+		digits[num_digits++] = '0' + (value % 10);
+		value /= 10;
+	} while(value);
+	for(uint8_t i = 0; i < num_digits; i++) {
+		text[i] = digits[num_digits - 1 - i];
+	}
+	text[num_digits] = 0;
+	return num_digits;
+}
@@ -86,4 +86,36 @@ void scroll_up(void);
 void draw_horizontal_line(int8_t y, int8_t startx, int8_t endx);
 void draw_vertical_line(int8_t x, int8_t starty, int8_t endy);
 
+// Heads up display (HUD) - a column of labelled numbers (score, level etc.)
+// at the top right of the terminal. The HUD remembers what is on the screen
+// and only sends the digits that have changed. Output is sent in frames
+// (at most one every HUD_FRAME_PERIOD ms) of at most HUD_BYTES_PER_FRAME
+// bytes (less if the serial output buffer is nearly full) so that it can't
+// fill up the buffer; changes that don't fit are sent in a later frame.
+typedef enum {
+	HUD_SCORE,
+	HUD_LEVEL,
+	HUD_LIVES,
+	HUD_COUNTDOWN,
+	HUD_NUM_FIELDS
+} HudField;
+
+#ifndef HUD_FRAME_PERIOD
+#define HUD_FRAME_PERIOD 50
+#endif
+#ifndef HUD_BYTES_PER_FRAME
+#define HUD_BYTES_PER_FRAME 48
+#endif
+
+// Forget what is on the screen (e.g. after clear_terminal()) so that every
+// field is redrawn, starting with the first frame at current_time.
+void hud_init(uint32_t current_time);
+
+// Set the value of a field. Nothing is sent until hud_update().
+void hud_set_field(HudField field, uint32_t value);
+
+// Send any changes if a frame is due. Call frequently with the current
+// time in ms.
+void hud_update(uint32_t current_time);
+
 #endif /* TERMINAL_IO_H */
\ No newline at end of file
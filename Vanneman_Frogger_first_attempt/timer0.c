@@ -12,27 +12,47 @@
 #include <avr/interrupt.h>
 
 #include "timer0.h"
+#include "spi.h"
+#include "profiler.h"
 
 #define TOTAL_TIME 15000
 
+// The countdown display is multiplexed (the two digits are shown
+// alternately) every MULTIPLEX_PERIOD ms, i.e. at 200Hz
+#define MULTIPLEX_PERIOD 5
+
 // Seven segment 0-9
 static uint8_t seven_seg[10] = {63, 6, 91, 79, 102, 109, 125, 7, 127, 111};
+#define SEVEN_SEG_ZERO_POINT 191	// "0."
 
 /* Our internal clock tick count - incremented every 
  * millisecond. Will overflow every ~49 days. */
 static volatile uint32_t clockTicks;
 
-// For frog countdown
+// Set by the interrupt handler every MULTIPLEX_PERIOD ms to tell
+// update_countdown_display() it is time to show the other digit
+static volatile uint8_t multiplex_due = 0;
+static volatile uint8_t ticks_until_multiplex = MULTIPLEX_PERIOD;
+
+// For frog countdown. The segment values for the left and right digits
+// are only worked out when the tenths of a second remaining changes.
+// left_digit_segments is 0 when only the right digit is shown.
 static  uint8_t countdown_inited = 0;
-static volatile uint8_t times_up = 0;
-static volatile uint32_t frog_start_time;
-static volatile uint8_t last_digit_shown = 0;
+static uint8_t times_up = 0;
+static uint32_t frog_deadline; // game time when time is up
+static uint8_t last_digit_shown = 0;
+static uint16_t tenths_shown;
+static uint8_t left_digit_segments;
+static uint8_t right_digit_segments;
+
+// The game clock is the clock tick minus game_clock_offset (the total
+// time it has been stopped for). game_clock_stopped_at is the game time
+// it stopped at - while stopped the game time stays there.
+static uint32_t game_clock_offset = 0;
+static uint32_t game_clock_stopped_at;
+static uint8_t game_clock_stopped = 0;
 
-// Implement pause feature
-static volatile uint32_t start_pause;
-static volatile uint32_t total_time_paused = 0;
-static volatile uint32_t paused_time = 0;
-static uint8_t is_paused = 0;
+static void show_countdown_digits(uint16_t time_remaining);
 
 
 /* Set up timer 0 to generate an interrupt every 1ms. 
@@ -75,70 +95,108 @@ void init_timer0(void) {
 	
 	// Countdown for frog
 	DDRC = 0XFF;
-	DDRD = (1<<2);
+	DDRD |= (1<<2);
 }
 
 uint32_t get_current_time(void) {
 	uint32_t returnValue;
 
-	/* Disable interrupts so we can be sure that the interrupt
-	 * doesn't fire when we've copied just a couple of bytes
-	 * of the value. Interrupts are re-enabled if they were
-	 * enabled at the start.
+	/* The interrupt could fire when we've copied just a couple of
+	 * bytes of the value, so we copy it until we get the same value
+	 * twice. Two copies take far less than a millisecond, so if the
+	 * interrupt fired during the first it can't also fire during the
+	 * second. This is cheaper than turning interrupts off (and doesn't
+	 * delay the interrupts).
 	 */
-	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
-	cli();
-	returnValue = clockTicks;
-	if(interruptsOn) {
-		sei();
-	}
+	do {
+		returnValue = clockTicks;
+	} while(returnValue != clockTicks);
+	return returnValue;
+}
+
+uint16_t get_current_time_16(void) {
+	uint16_t returnValue;
+
+	/* As above, but only the bottom two bytes */
+	do {
+		returnValue = (uint16_t)clockTicks;
+	} while(returnValue != (uint16_t)clockTicks);
 	return returnValue;
 }
 
 ISR(TIMER0_COMPA_vect) {
+	PROFILE_BEGIN(PROFILE_TIMER0_ISR);
+	
 	/* Increment our clock tick count */
 	clockTicks++;
 	
-	paused_time = amount_time_paused();
+	/* Allow the next burst of bytes out to the LED matrix */
+	spi_rate_limit_tick();
 	
-	// Find time remaining
-	uint32_t time_remaining = TOTAL_TIME - (get_current_time() - paused_time - frog_start_time);
+	/* Tell the main loop when it is time to multiplex the countdown */
+	if(--ticks_until_multiplex == 0) {
+		ticks_until_multiplex = MULTIPLEX_PERIOD;
+		multiplex_due = 1;
+	}
+	
+	PROFILE_END(PROFILE_TIMER0_ISR);
+}
+
+void update_countdown_display(void) {
+	if(!multiplex_due) {
+		return;
+	}
+	multiplex_due = 0;
+	if(!countdown_inited) {
+		// Time is up (or countdown not started) - leave the display alone
+		return;
+	}
 	
-	if (countdown_inited && time_remaining <= 0) {
+	// The countdown runs on the game clock so it stops while paused
+	uint32_t now = get_game_time();
+	if (time_after_eq(now, frog_deadline)) {
+		// Frog ran out of time - show 0 on the right digit
 		times_up = 1;
 		PORTC = 0;
 		PORTD &= ~(1<<2);
 		PORTC = seven_seg[0];
 		countdown_inited = 0;
-	} else if (countdown_inited && last_digit_shown == 0) {
-		if (time_remaining < 10000 && time_remaining >= 1000) {
-			// Already correctly set
-			PORTC = seven_seg[time_remaining/1000];
-		} else if (time_remaining <= 15000 && time_remaining >= 10000){
+		return;
+	}
+	
+	uint16_t time_remaining = frog_deadline - now;
+	if(time_remaining / 100 != tenths_shown) {
+		show_countdown_digits(time_remaining);
+	}
 	
-			PORTD |= (1<<2); // Show leftmost digit
-			PORTC = seven_seg[1];
-			last_digit_shown = 1;
-		} else if (time_remaining < 1000 && time_remaining > 0) {
-			PORTD |= (1<<2); // Show leftmost digit
-			PORTC = 191;
-			//PORTC = seven_seg[0]; // Will always be 0
-			//PORTC = (1<<7); // Show decimal point
-			last_digit_shown = 1;
-		}
-	} else if (countdown_inited && last_digit_shown == 1) {
-		if (time_remaining <= 15000 && time_remaining >= 10000){
-			// 10-15 seconds
-			PORTC = 0;
-			PORTD &= ~(1<<2); // Make value 0
-			PORTC = seven_seg[(time_remaining/1000)%10];
-			last_digit_shown = 0;
-		} else if (time_remaining < 1000 && time_remaining > 0) {
-			PORTC = 0;
-			PORTD &= ~(1<<2); // Show rightmost digit
-			PORTC = seven_seg[time_remaining/100];
-			last_digit_shown = 0;
-		}
+	// Show the other digit (if both are in use). We blank the segments
+	// before changing digit so the old value doesn't flash on the new digit.
+	PORTC = 0;
+	if(left_digit_segments && last_digit_shown == 0) {
+		PORTD |= (1<<2); // Show leftmost digit
+		PORTC = left_digit_segments;
+		last_digit_shown = 1;
+	} else {
+		PORTD &= ~(1<<2); // Show rightmost digit
+		PORTC = right_digit_segments;
+		last_digit_shown = 0;
+	}
+}
+
+// Work out the segments to show for the given time remaining (ms):
+// 10-15 seconds shows "1" and the units digit, 1-9 seconds shows just the
+// units digit and under 1 second shows "0." and the tenths digit.
+static void show_countdown_digits(uint16_t time_remaining) {
+	tenths_shown = time_remaining / 100;
+	if (time_remaining >= 10000) {
+		left_digit_segments = seven_seg[1];
+		right_digit_segments = seven_seg[(tenths_shown / 10) % 10];
+	} else if (time_remaining >= 1000) {
+		left_digit_segments = 0;
+		right_digit_segments = seven_seg[tenths_shown / 10];
+	} else {
+		left_digit_segments = SEVEN_SEG_ZERO_POINT;
+		right_digit_segments = seven_seg[tenths_shown];
 	}
 }
 
@@ -147,33 +205,43 @@ void init_countdown() {
 	times_up = 0;
 	countdown_inited = 1;
 	last_digit_shown = 0;
-	total_time_paused = 0;
-	frog_start_time = get_current_time();
+	frog_deadline = get_game_time() + TOTAL_TIME;
+	show_countdown_digits(TOTAL_TIME);
+}
+
+uint8_t countdown_seconds_remaining(void) {
+	if(!countdown_inited) {
+		return 0;
+	}
+	return (tenths_shown + 9) / 10;
 }
 
 uint8_t is_time_up(){
 	return times_up;
 }
 
-void countdown_pause(){
-	if (is_paused == 0) {
-		start_pause = get_current_time();
-		is_paused = 1;
-	} else {
-		total_time_paused += get_current_time() - start_pause;
-		is_paused = 0;
+uint32_t get_game_time(void) {
+	if(game_clock_stopped) {
+		return game_clock_stopped_at;
 	}
+	return get_current_time() - game_clock_offset;
 }
 
-uint32_t amount_time_paused(void){
-	uint32_t return_value = 0;
-	if (is_paused) {
-		return_value = total_time_paused + (get_current_time() - start_pause);
-		return return_value;
-	} else {
-		// If not paused, only change by how
-		// much has been paused by in past
-		return total_time_paused;
+void pause_game_clock(void) {
+	if(!game_clock_stopped) {
+		game_clock_stopped_at = get_game_time();
+		game_clock_stopped = 1;
 	}
-	
+}
+
+void resume_game_clock(void) {
+	if(game_clock_stopped) {
+		// Carry on from the time we stopped at
+		game_clock_offset = get_current_time() - game_clock_stopped_at;
+		game_clock_stopped = 0;
+	}
+}
+
+uint8_t game_clock_paused(void) {
+	return game_clock_stopped;
 }
\ No newline at end of file
@@ -27,14 +27,55 @@ void init_timer0(void);
 
 void init_countdown(void);
 
+/* Update the countdown shown on the seven segment display. This should be
+ * called frequently from the main loop - it does nothing unless it is time
+ * to multiplex the display (every 5ms).
+ */
+void update_countdown_display(void);
+
 uint8_t is_time_up(void);
 
-void countdown_pause(void);
-uint32_t amount_time_paused(void);
+/* Return the whole number of seconds left on the countdown (rounded up),
+ * as at the last update_countdown_display(). 0 once time is up.
+ */
+uint8_t countdown_seconds_remaining(void);
 
 /* Return the current clock tick value - milliseconds since the timer was
- * initialised.
+ * initialised. Interrupts are not turned off - the count is read until two
+ * reads in a row agree (the count can only change once between them), so
+ * this is safe to call from anywhere, including with interrupts off.
  */
 uint32_t get_current_time(void);
 
+/* Return the bottom 16 bits of the clock tick value. Cheaper than
+ * get_current_time() - use it for timing short intervals (less than
+ * about 32 seconds) with the time16_ comparisons below.
+ */
+uint16_t get_current_time_16(void);
+
+/* Compare clock tick values, e.g. time_after_eq(now, deadline) is 1 once a
+ * deadline has been reached. The comparisons are done on the difference
+ * between the times, so they still work when the clock tick count wraps
+ * around (every ~49 days) - as long as the times are less than half the
+ * range apart (~24 days, or ~32 seconds for the 16 bit versions).
+ */
+#define time_after(a, b)		((int32_t)((uint32_t)(b) - (uint32_t)(a)) < 0)
+#define time_after_eq(a, b)		((int32_t)((uint32_t)(a) - (uint32_t)(b)) >= 0)
+#define time_before(a, b)		time_after(b, a)
+#define time_before_eq(a, b)	time_after_eq(b, a)
+#define time16_after(a, b)		((int16_t)((uint16_t)(b) - (uint16_t)(a)) < 0)
+#define time16_after_eq(a, b)	((int16_t)((uint16_t)(a) - (uint16_t)(b)) >= 0)
+
+/* The game clock - milliseconds like get_current_time(), except that it
+ * doesn't move while the game is paused. Everything that moves in the
+ * game (the lanes - see scheduler.h, the countdown, the autopilot and
+ * button auto repeat) runs on game time, so pausing and resuming the
+ * game clock pauses and resumes all of them together. Pausing or
+ * resuming a clock that is already paused or running does nothing.
+ */
+uint32_t get_game_time(void);
+void pause_game_clock(void);
+void resume_game_clock(void);
+uint8_t game_clock_paused(void);
+
 #endif
\ No newline at end of file